@@ -0,0 +1,352 @@
+/*
+ * mwbench - headless micro-benchmarks for the engine drawing primitives
+ *
+ * Times GdFillRect, GdLine, GdBlit, GdStretchBlit, GdText, GdFillPoly,
+ * GdArea and the RGBA alpha blend convblit against memory pixmaps
+ * created with GdCreatePixmap, so no display or server is needed.
+ * Each primitive is run for each pixmap format, size and clip region
+ * complexity, and the results are written as CSV or JSON with
+ * operations and megapixels per second, for comparison between builds.
+ *
+ * Usage: mwbench [-j] [-t msecs] [-b test] [-f format]
+ *	-j		JSON output (default CSV)
+ *	-t msecs	time to run each case (default 200)
+ *	-b test		run only the named test (fillrect, line, blit, ...)
+ *	-f format	run only the named format (8888, 565, pal8)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "uni_std.h"
+#include "device.h"
+#include "../../drivers/genmem.h"
+
+#define WIDTH		512		/* pixmap size*/
+#define HEIGHT		512
+
+extern MWPALENTRY gr_palette[256];
+
+typedef struct {
+	PSD			psd;		/* destination pixmap*/
+	PSD			srcpsd;		/* source pixmap for blits*/
+	PMWFONT		font;
+	uint32_t *	image;		/* RGBA8888 image for GdArea and blend*/
+	int			size;		/* current case size*/
+	MWCOORD		textw, texth;
+} BENCH;
+
+typedef struct {
+	const char *name;
+	int		sizes[4];		/* 0 terminated*/
+	long	(*run)(BENCH *b, int i);	/* draw once, return pixels drawn*/
+	int		(*check)(BENCH *b);			/* return 0 if unsupported for format*/
+} TEST;
+
+static const char *text = "The quick brown fox jumps over the lazy dog";
+
+/* step through positions so that successive draws don't hit the same pixels*/
+#define XPOS(b,i)	(((i) * 37) % (WIDTH - (b)->size))
+#define YPOS(b,i)	(((i) * 53) % (HEIGHT - (b)->size))
+
+static long
+bench_fillrect(BENCH *b, int i)
+{
+	GdFillRect(b->psd, XPOS(b,i), YPOS(b,i), b->size, b->size);
+	return (long)b->size * b->size;
+}
+
+static long
+bench_line(BENCH *b, int i)
+{
+	MWCOORD x = XPOS(b,i);
+	MWCOORD y = YPOS(b,i);
+
+	GdLine(b->psd, x, y, x + b->size - 1, y + b->size - 1, TRUE);
+	return b->size;
+}
+
+static long
+bench_blit(BENCH *b, int i)
+{
+	GdBlit(b->psd, XPOS(b,i), YPOS(b,i), b->size, b->size, b->srcpsd, i & 63, i & 31, MWROP_COPY);
+	return (long)b->size * b->size;
+}
+
+/* 2x enlarge*/
+static long
+bench_stretch(BENCH *b, int i)
+{
+	MWCOORD x = XPOS(b,i);
+	MWCOORD y = YPOS(b,i);
+
+	GdStretchBlit(b->psd, x, y, x + b->size, y + b->size, b->srcpsd,
+		i & 63, i & 31, (i & 63) + b->size/2, (i & 31) + b->size/2, MWROP_COPY);
+	return (long)b->size * b->size;
+}
+
+/* size is number of characters*/
+static long
+bench_text(BENCH *b, int i)
+{
+	GdText(b->psd, b->font, i & 127, (i * 53) % (HEIGHT - b->texth), text, b->size, MWTF_ASCII|MWTF_TOP);
+	return (long)b->textw * b->texth;
+}
+
+static int
+check_text(BENCH *b)
+{
+	MWCOORD base;
+
+	GdGetTextSize(b->font, text, b->size, &b->textw, &b->texth, &base, MWTF_ASCII);
+	return 1;
+}
+
+/* hexagon in size x size box, 3/4 filled*/
+static long
+bench_fillpoly(BENCH *b, int i)
+{
+	MWCOORD x = XPOS(b,i);
+	MWCOORD y = YPOS(b,i);
+	MWCOORD s = b->size;
+	MWPOINT pts[6];
+
+	pts[0].x = x + s/4;		pts[0].y = y;
+	pts[1].x = x + s*3/4;	pts[1].y = y;
+	pts[2].x = x + s - 1;	pts[2].y = y + s/2;
+	pts[3].x = x + s*3/4;	pts[3].y = y + s - 1;
+	pts[4].x = x + s/4;		pts[4].y = y + s - 1;
+	pts[5].x = x;			pts[5].y = y + s/2;
+	GdFillPoly(b->psd, 6, pts);
+	return (long)s * s * 3 / 4;
+}
+
+/* RGBA8888 image copy, uses convblit or GdAreaByPoint fallback*/
+static long
+bench_area(BENCH *b, int i)
+{
+	GdArea(b->psd, XPOS(b,i), YPOS(b,i), b->size, b->size, b->image, MWPF_RGB);
+	return (long)b->size * b->size;
+}
+
+/* RGBA8888 image alpha blend convblit*/
+static long
+bench_blend(BENCH *b, int i)
+{
+	MWBLITPARMS parms;
+
+	parms.data_format = MWIF_RGBA8888;
+	parms.op = MWROP_SRC_OVER;
+	parms.width = b->size;
+	parms.height = b->size;
+	parms.dstx = XPOS(b,i);
+	parms.dsty = YPOS(b,i);
+	parms.srcx = 0;
+	parms.srcy = 0;
+	parms.src_pitch = b->size * 4;
+	parms.data = (char *)b->image;
+	GdConversionBlit(b->psd, &parms);
+	return (long)b->size * b->size;
+}
+
+static int
+check_blend(BENCH *b)
+{
+	return GdFindConvBlit(b->psd, MWIF_RGBA8888, MWROP_SRC_OVER) != NULL;
+}
+
+static TEST tests[] = {
+	{ "fillrect",	{ 16, 64, 256, 0 },	bench_fillrect,	NULL },
+	{ "line",		{ 16, 64, 256, 0 },	bench_line,		NULL },
+	{ "blit",		{ 16, 64, 256, 0 },	bench_blit,		NULL },
+	{ "stretchblit",{ 16, 64, 256, 0 },	bench_stretch,	NULL },
+	{ "text",		{ 8, 32, 0 },		bench_text,		check_text },
+	{ "fillpoly",	{ 16, 64, 256, 0 },	bench_fillpoly,	NULL },
+	{ "area",		{ 16, 64, 256, 0 },	bench_area,		NULL },
+	{ "blend",		{ 16, 64, 256, 0 },	bench_blend,	check_blend },
+	{ NULL }
+};
+
+static struct {
+	const char *name;
+	MWIMGDATFMT	format;
+} formats[] = {
+	{ "8888",	MWIF_BGRA8888 },	/* MWPF_TRUECOLOR8888*/
+	{ "565",	MWIF_RGB565 },		/* MWPF_TRUECOLOR565*/
+	{ "pal8",	MWIF_PAL8 },		/* MWPF_PALETTE*/
+	{ NULL }
+};
+
+/* clip regions: whole pixmap, or a grid of n x n rectangles with gaps*/
+static struct {
+	const char *name;
+	int		grid;
+} clips[] = {
+	{ "none",	0 },
+	{ "rects16",	4 },
+	{ "rects256",	16 },
+	{ NULL }
+};
+
+static void
+set_clip(PSD psd, int grid)
+{
+	MWCLIPREGION *reg;
+	MWRECT rc;
+	int x, y, step;
+
+	if (!grid) {
+		GdSetClipRegion(psd, GdAllocRectRegion(0, 0, WIDTH, HEIGHT));
+		return;
+	}
+	reg = GdAllocRegion();
+	step = WIDTH / grid;
+	for (y = 0; y < grid; y++) {
+		for (x = 0; x < grid; x++) {
+			rc.left = x * step;
+			rc.top = y * step;
+			rc.right = rc.left + step - 4;
+			rc.bottom = rc.top + step - 4;
+			GdUnionRectWithRegion(&rc, reg);
+		}
+	}
+	GdSetClipRegion(psd, reg);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* fill pixmap and image with pattern*/
+static void
+fill_pattern(BENCH *b)
+{
+	int i;
+	uint32_t seed = 1;
+
+	for (i = 0; i < WIDTH*HEIGHT; i++) {
+		seed = seed * 1103515245 + 12345;
+		b->image[i] = seed >> 8 | (i & 0x80? 0xff000000: 0x80000000);
+	}
+	GdArea(b->srcpsd, 0, 0, WIDTH, HEIGHT, b->image, MWPF_RGB);
+}
+
+int
+main(int argc, char **argv)
+{
+	BENCH bench, *b = &bench;
+	TEST *t;
+	int f, c, s, i, n;
+	int json = 0, msecs = 200, first = 1;
+	char *onlytest = NULL, *onlyformat = NULL;
+
+	while ((i = getopt(argc, argv, "jt:b:f:")) != -1) {
+		switch (i) {
+		case 'j':
+			json = 1;
+			break;
+		case 't':
+			msecs = atoi(optarg);
+			break;
+		case 'b':
+			onlytest = optarg;
+			break;
+		case 'f':
+			onlyformat = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: mwbench [-j] [-t msecs] [-b test] [-f format]\n");
+			return 1;
+		}
+	}
+
+	/* screen is never opened, set packed pixels for memory subdriver selection*/
+	scrdev.planes = 1;
+
+	/* 3-3-2 palette for pal8 pixmaps*/
+	for (i = 0; i < 256; i++) {
+		gr_palette[i].r = (i >> 5) * 255 / 7;
+		gr_palette[i].g = ((i >> 2) & 7) * 255 / 7;
+		gr_palette[i].b = (i & 3) * 255 / 3;
+	}
+
+	b->image = malloc(WIDTH * HEIGHT * sizeof(uint32_t));
+	if (!b->image)
+		return 1;
+
+	if (json)
+		printf("{\n\"results\": [\n");
+	else
+		printf("test,format,clip,size,ops,secs,ops_per_sec,mpixels_per_sec\n");
+
+	for (f = 0; formats[f].name; f++) {
+		if (onlyformat && strcmp(onlyformat, formats[f].name))
+			continue;
+
+		/* memory pixmaps only, display is never opened*/
+		b->psd = GdCreatePixmap(&scrdev, WIDTH, HEIGHT, formats[f].format, NULL, 0);
+		b->srcpsd = GdCreatePixmap(&scrdev, WIDTH, HEIGHT, formats[f].format, NULL, 0);
+		if (!b->psd || !b->srcpsd) {
+			fprintf(stderr, "mwbench: can't create %s pixmap\n", formats[f].name);
+			return 1;
+		}
+		GdSetMode(MWROP_COPY);
+		GdSetFillMode(MWFILL_SOLID);
+		GdSetUseBackground(FALSE);
+		GdSetForegroundColor(b->psd, MWRGB(255, 128, 0));
+		GdSetBackgroundColor(b->psd, MWRGB(0, 0, 64));
+		b->font = GdCreateFont(b->psd, MWFONT_SYSTEM_VAR, 0, 0, NULL);
+		set_clip(b->srcpsd, 0);
+		fill_pattern(b);
+
+		for (t = tests; t->name; t++) {
+			if (onlytest && strcmp(onlytest, t->name))
+				continue;
+			for (c = 0; clips[c].name; c++) {
+				set_clip(b->psd, clips[c].grid);
+				for (s = 0; t->sizes[s]; s++) {
+					double start, secs;
+					long pixels = 0;
+
+					b->size = t->sizes[s];
+					if (t->check && !t->check(b))
+						continue;
+
+					/* run in batches until time is up*/
+					t->run(b, 0);
+					n = 0;
+					start = now();
+					do {
+						for (i = 0; i < 16; i++, n++)
+							pixels += t->run(b, n);
+						secs = now() - start;
+					} while (secs * 1000 < msecs);
+
+					if (json)
+						printf("%s{\"test\":\"%s\",\"format\":\"%s\",\"clip\":\"%s\",\"size\":%d,"
+							"\"ops\":%d,\"secs\":%.4f,\"ops_per_sec\":%.1f,\"mpixels_per_sec\":%.2f}",
+							first? "": ",\n", t->name, formats[f].name, clips[c].name, b->size,
+							n, secs, n / secs, pixels / secs / 1e6);
+					else
+						printf("%s,%s,%s,%d,%d,%.4f,%.1f,%.2f\n",
+							t->name, formats[f].name, clips[c].name, b->size,
+							n, secs, n / secs, pixels / secs / 1e6);
+					first = 0;
+					fflush(stdout);
+				}
+			}
+		}
+		GdDestroyFont(b->font);
+		GdFreePixmap(b->srcpsd);
+		GdFreePixmap(b->psd);
+	}
+	if (json)
+		printf("\n]\n}\n");
+	free(b->image);
+	return 0;
+}
@@ -21,19 +21,16 @@
 #include "fb.h"
 #include "genmem.h"
 
-/*
- * Alpha lookup tables for 256 color palette systems
- * A 5 bit alpha value is used to keep tables smaller.
- *
- * Two tables are created.  The first, alpha_to_rgb contains 15 bit RGB 
- * values for each alpha value for each color: 32*256 short words.
- * RGB values can then be blended.  The second, rgb_to_palindex contains
- * the closest color (palette index) for each of the 5-bit
- * R, G, and B values: 32*32*32 bytes.
- */
-static unsigned short *alpha_to_rgb = NULL;
-static unsigned char  *rgb_to_palindex = NULL;
-static int init_alpha_lookup(void);
+/* RGBA and RGB images are converted through the inverse colormap*/
+#if MW_FEATURE_PALETTE
+#define linear8_convblit_copy_rgba8888		convblit_copy_rgba8888_8bpp
+#define linear8_convblit_srcover_rgba8888	convblit_srcover_rgba8888_8bpp
+#define linear8_convblit_copy_rgb888		convblit_copy_rgb888_8bpp
+#else
+#define linear8_convblit_copy_rgba8888		NULL	/* images will use GdDrawAreaByPoint fallback*/
+#define linear8_convblit_srcover_rgba8888	NULL	/* images will use GdDrawImageByPoint fallback*/
+#define linear8_convblit_copy_rgb888		NULL
+#endif
 
 /* Set pixel at x, y, to pixelval c*/
 static void
@@ -128,51 +125,6 @@ linear8_drawvertline(PSD psd, MWCOORD x, MWCOORD y1, MWCOORD y2, MWPIXELVAL c)
 		psd->Update(psd, x, y1, 1, height);
 }
 
-#if MW_FEATURE_PALETTE
-/* FIXME create lookup table whenever palette changed*/
-static int
-init_alpha_lookup(void)
-{
-	int	i, a;
-	int	r, g, b;
-	extern MWPALENTRY gr_palette[256];
-
-	if(!alpha_to_rgb)
-		alpha_to_rgb = (unsigned short *)malloc(sizeof(unsigned short)*32*256);
-	if(!rgb_to_palindex)
-		rgb_to_palindex = (unsigned char *)malloc(sizeof(unsigned char)*32*32*32);
-	if(!rgb_to_palindex || !alpha_to_rgb)
-		return 0;
-
-	/*
-	 * Precompute alpha to rgb lookup by premultiplying
-	 * each palette rgb value by each possible alpha
-	 * and storing it as RGB555.
-	 */
-	for(i=0; i<256; ++i) {
-		MWPALENTRY *p = &gr_palette[i];
-		for(a=0; a<32; ++a) {
-			alpha_to_rgb[(a<<8)+i] =
-				(((p->r * a / 31)>>3) << 10) |
-				(((p->g * a / 31)>>3) << 5) |
-				 ((p->b * a / 31)>>3);
-		}
-	}
-
-	/*
-	 * Precompute RGB555 to palette index table by
-	 * finding the nearest palette index for all RGB555 colors.
-	 */
-	for(r=0; r<32; ++r) {
-		for(g=0; g<32; ++g)
-			for(b=0; b<32; ++b)
-				rgb_to_palindex[ (r<<10)|(g<<5)|b] =
-					GdFindNearestColor(gr_palette, 256, MWRGB(r<<3, g<<3, b<<3));
-	}
-	return 1;
-}
-#endif /* MW_FEATURE_PALETTE*/
-
 /*
  * Routine to draw mono 1bpp MSBFirst bitmap to 8bpp
  * Bitmap is byte array.
@@ -564,12 +516,14 @@ linear8_convblit_blend_mask_alpha_byte(PSD psd, PMWBLITPARMS gc)
 	int x, y;
 	unsigned int as;
 	int src_row_step, dst_row_step;
+	unsigned char *invcmap;
+	MWPALENTRY *fg, *d;
+	extern MWPALENTRY gr_palette[256];
 
-	/* init alpha lookup tables*/
-	if(!rgb_to_palindex) {
-		if (!init_alpha_lookup())
-			return;
-	}
+	/* blend palette colors, then map back through the inverse colormap*/
+	if (!(invcmap = GdGetInverseColormap(psd)))
+		return;
+	fg = &gr_palette[gc->fg_pixelval];
 
 	alpha = ((ADDR8) gc->data) + gc->src_pitch * gc->srcy + gc->srcx;
 	dst = ((ADDR8) gc->data_out) + gc->dst_pitch * gc->dsty + gc->dstx;
@@ -583,16 +537,12 @@ linear8_convblit_blend_mask_alpha_byte(PSD psd, PMWBLITPARMS gc)
 			if ((as = *alpha++) == 255)
 				*dst++ = gc->fg_pixelval;
 			else if (as != 0) {
-				/* Create 5 bit alpha value index for 256 color indexing*/
-
-				/* Get source RGB555 value for source alpha value*/
-				unsigned short s = alpha_to_rgb[((as >> 3) << 8) + gc->fg_pixelval];
-
-				/* Get destination RGB555 value for dest alpha value*/
-				unsigned short d = alpha_to_rgb[(((as >> 3) ^ 31) << 8) + *dst];
-
-				/* Add RGB values together and get closest palette index to it*/
-				*dst++ = rgb_to_palindex[s + d];
+				/* d += muldiv255(a, s - d)*/
+				d = &gr_palette[*dst];
+				*dst++ = invcmap[RGB2PIXEL555(
+					d->r + muldiv255(as, fg->r - d->r),
+					d->g + muldiv255(as, fg->g - d->g),
+					d->b + muldiv255(as, fg->b - d->b))];
 			} else if(gc->usebg)		/* alpha 0 - draw bkgnd*/
 				*dst++ = gc->bg_pixelval;
 			else
@@ -621,9 +571,9 @@ static SUBDRIVER fblinear8_none = {
 	linear8_convblit_copy_mask_mono_byte_lsb,	/* T1LIB non-alias*/
 	NULL,		/* BlitCopyMaskMonoWordMSB*/	/* core, PCF, FNT will use GdBitmap fallback*/
 	linear8_convblit_blend_mask_alpha_byte,		/* FT2/T1 anti-alias*/
-	NULL,		/* BlitCopyRGBA8888*/			/* images will use GdDrawAreaByPoint fallback*/
-	NULL,		/* BlitSrcOverRGBA8888*/		/* images will use GdDrawImageByPoint fallback*/
-	NULL,		/* BlitCopyRGB888*/				/* images will use GdDrawImageByPoint fallback*/
+	linear8_convblit_copy_rgba8888,		/* RGBA image copy (GdArea MWPF_RGB)*/
+	linear8_convblit_srcover_rgba8888,	/* RGBA images w/alpha*/
+	linear8_convblit_copy_rgb888,		/* RGB images no alpha*/
 	NULL		/* BlitStretchRGBA8888*/
 };
 
@@ -641,9 +591,9 @@ SUBDRIVER fblinear8_left = {
 	fbportrait_left_convblit_copy_mask_mono_byte_lsb,	/* T1LIB non-alias*/
 	NULL,		/* BlitCopyMaskMonoWordMSB*/
 	fbportrait_left_convblit_blend_mask_alpha_byte,		/* FT2/T1 anti-alias*/
-	NULL,		/* BlitSrcOverRGBA8888*/
-	NULL,		/* BlitSrcOverRGBA8888*/
-	NULL,		/* BlitCopyRGB888*/
+	linear8_convblit_copy_rgba8888,		/* RGBA image copy (GdArea MWPF_RGB)*/
+	linear8_convblit_srcover_rgba8888,	/* RGBA images w/alpha*/
+	linear8_convblit_copy_rgb888,		/* RGB images no alpha*/
 	NULL		/* BlitStretchRGBA8888*/
 };
 
@@ -660,9 +610,9 @@ SUBDRIVER fblinear8_right = {
 	fbportrait_right_convblit_copy_mask_mono_byte_lsb,	/* T1LIB non-alias*/
 	NULL,		/* BlitCopyMaskMonoWordMSB*/
 	fbportrait_right_convblit_blend_mask_alpha_byte,	/* FT2/T1 anti-alias*/
-	NULL,		/* BlitSrcOverRGBA8888*/
-	NULL,		/* BlitSrcOverRGBA8888*/
-	NULL,		/* BlitCopyRGB888*/
+	linear8_convblit_copy_rgba8888,		/* RGBA image copy (GdArea MWPF_RGB)*/
+	linear8_convblit_srcover_rgba8888,	/* RGBA images w/alpha*/
+	linear8_convblit_copy_rgb888,		/* RGB images no alpha*/
 	NULL		/* BlitStretchRGBA8888*/
 };
 
@@ -679,9 +629,9 @@ SUBDRIVER fblinear8_down = {
 	fbportrait_down_convblit_copy_mask_mono_byte_lsb,	/* T1LIB non-alias*/
 	NULL,		/* BlitCopyMaskMonoWordMSB*/
 	fbportrait_down_convblit_blend_mask_alpha_byte,		/* FT2/T1 anti-alias*/
-	NULL,		/* BlitCopyRGBA8888*/
-	NULL,		/* BlitSrcOverRGBA8888*/
-	NULL,		/* BlitCopyRGB888*/
+	linear8_convblit_copy_rgba8888,		/* RGBA image copy (GdArea MWPF_RGB)*/
+	linear8_convblit_srcover_rgba8888,	/* RGBA images w/alpha*/
+	linear8_convblit_copy_rgb888,		/* RGB images no alpha*/
 	NULL		/* BlitStretchRGBA8888*/
 };
 #endif
@@ -12,6 +12,7 @@
 #include "device.h"
 #include "fb.h"
 #include "genmem.h"
+#include "convblit.h"
 
 /* alloc and initialize a new memory drawing surface (memgc)*/
 PSD
@@ -386,6 +387,11 @@ set_subdriver(PSD psd, PSUBDRIVER subdriver)
 	psd->BlitSrcOverRGBA8888     = subdriver->BlitSrcOverRGBA8888;
 	psd->BlitCopyRGB888          = subdriver->BlitCopyRGB888;
 	psd->BlitStretchRGBA8888     = subdriver->BlitStretchRGBA8888;
+
+#if MW_FEATURE_SIMD
+	/* replace RGBA/RGB conversion blits with vectorized versions*/
+	convblit_simd_select(psd);
+#endif
 }
 
 /* fill in a subdriver struct from passed screen device*/
@@ -46,6 +46,12 @@
 #define unix
 #endif
 
+/* map bitmap files so glyphs are paged in on demand rather than read*/
+#if HAVE_MMAP && !defined(IN_MEMORY)
+#define BM_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifdef __MSDOS__
 #define msdos
 #endif
@@ -129,6 +135,9 @@ BM_FILE {
 	byte	*bmf_contents;
 #else
 	FILE	*bmf_file;
+#endif
+#ifdef BM_MMAP
+	byte	*bmf_map;	/* mapped contents, NULL if not mapped */
 #endif
 	long	bmf_size;
 	BM_FILE	*bmf_next;
@@ -658,6 +667,15 @@ reg	BM_FILE	*file;
 	file->bmf_file = f;
 	fseek(f, 0L, 2);
 	file->bmf_size = ftell(f);
+#ifdef BM_MMAP
+	file->bmf_map = NULL;
+	if (file->bmf_size > 0) {
+		file->bmf_map = (byte *)mmap(NULL, (size_t)file->bmf_size,
+			PROT_READ, MAP_SHARED, fileno(f), 0);
+		if (file->bmf_map == (byte *)MAP_FAILED)
+			file->bmf_map = NULL;
+	}
+#endif /* BM_MMAP */
 #endif /* ! IN_MEMORY */
 	file->bmf_next = NULL;
 	*fp = file;
@@ -1172,6 +1190,10 @@ reg	HBF_STRUCT	*hbf;
 #ifdef IN_MEMORY
 		free((char *)(bmf_ptr->bmf_contents));
 #else
+#ifdef BM_MMAP
+		if (bmf_ptr->bmf_map != NULL)
+			munmap((char *)bmf_ptr->bmf_map, (size_t)bmf_ptr->bmf_size);
+#endif
 		if (bmf_ptr->bmf_file != NULL &&
 		    fclose(bmf_ptr->bmf_file) < 0)
 			status = -1;
@@ -1243,6 +1265,20 @@ reg	CODE_RANGE	*cp;
 			    ! cp->code_transposed && ! cp->code_inverted)
 				return bmf->bmf_contents + offset;
 #endif /* IN_MEMORY */
+#ifdef BM_MMAP
+			if (bmf->bmf_map != NULL &&
+			    ! cp->code_transposed && ! cp->code_inverted) {
+				if (offset + bm_size > bmf->bmf_size) {
+					eprintf("read error on code 0x%04x", code);
+					return NULL;
+				}
+				if (buffer == NULL)
+					return bmf->bmf_map + offset;
+				memcpy((char *)buffer,
+				       (char *)(bmf->bmf_map + offset), bm_size);
+				return buffer;
+			}
+#endif /* BM_MMAP */
 			if (buffer == NULL &&
 			    ((buffer = local_buffer(hbf)) == NULL))
 				return NULL;
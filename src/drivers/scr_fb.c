@@ -41,6 +41,12 @@ static void fb_close(PSD psd);
 static void fb_setpalette(PSD psd,int first, int count, MWPALENTRY *palette);
 static PSD open_linuxfb(PSD psd);
 static void	set_directcolor_palette(PSD psd);
+#if MW_FEATURE_FBSHADOW
+static int	fb_setpages(PSD psd);
+static void	fb_openshadow(PSD psd);
+static int	fb_preselect(PSD psd);
+static void	fb_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+#endif
 
 /* static variables*/
 static int fb = -1;				/* framebuffer file handle*/
@@ -51,6 +57,14 @@ static short saved_blue[16];
 static struct fb_fix_screeninfo  fb_fix;
 static struct fb_var_screeninfo fb_var;
 #endif
+#if MW_FEATURE_FBSHADOW
+static unsigned char *fb_hwaddr;	/* mmapped framebuffer when psd->addr is shadow*/
+static unsigned int fb_hwsize;		/* mmapped framebuffer size*/
+static int fb_pages = 1;			/* 2 if double buffered with FBIOPAN_DISPLAY*/
+static int fb_backpage;				/* framebuffer page written by next flush*/
+static MWCLIPREGION *fb_damage;		/* shadow damage not yet copied to framebuffer*/
+static MWCLIPREGION *fb_backdamage;	/* previous flush damage missing from back page*/
+#endif
 
 SCREENDEVICE	scrdev = {
 	0, 0, 0, 0, 0, 0, 0, NULL, 0, NULL, 0, 0, 0, 0, 0, 0,
@@ -223,6 +237,12 @@ open_linuxfb(PSD psd)
 	}
 #endif
 
+#if MW_FEATURE_FBSHADOW
+	/* mmap both pages when double buffering shadow flushes*/
+	fb_pages = fb_setpages(psd);
+	psd->size = psd->yres * psd->pitch * fb_pages;
+#endif
+
 	/* mmap framebuffer into this address space*/
 	psd->size = (psd->size + extra) & ~extra;		/* extend to page boundary*/
 
@@ -264,6 +284,11 @@ open_linuxfb(PSD psd)
 	if(visual == FB_VISUAL_DIRECTCOLOR)
 		set_directcolor_palette(psd);
 
+#if MW_FEATURE_FBSHADOW
+	/* draw into system memory from here on*/
+	fb_openshadow(psd);
+#endif
+
 	return psd;	/* success*/
 
 fail:
@@ -285,6 +310,21 @@ fb_close(PSD psd)
 	ioctl_setpalette(0, 16, saved_red, saved_green, saved_blue);
   
 	/* unmap framebuffer*/
+#if MW_FEATURE_FBSHADOW
+	if (fb_hwaddr) {
+		/* leave first page displayed*/
+		if (fb_pages == 2) {
+			fb_var.yoffset = 0;
+			ioctl(fb, FBIOPAN_DISPLAY, &fb_var);
+		}
+		munmap(fb_hwaddr, fb_hwsize);
+		fb_hwaddr = NULL;
+		free(psd->addr);
+		GdDestroyRegion(fb_damage);
+		GdDestroyRegion(fb_backdamage);
+		fb_damage = fb_backdamage = NULL;
+	} else
+#endif
 	munmap(psd->addr, psd->size);
   
 #if HAVE_TEXTMODE
@@ -302,6 +342,179 @@ fb_close(PSD psd)
 	fb = -1;
 }
 
+#if MW_FEATURE_FBSHADOW
+/*
+ * Shadow framebuffer.  All drawing goes to a cached system memory copy
+ * of the screen, so reads and read-modify-write blending don't touch
+ * uncached video memory.  Update only records damage, which is copied
+ * to the framebuffer in PreSelect.  With MW_FBSHADOW_PAGEFLIP the copy
+ * goes to the hidden page and is then panned into view, so the display
+ * never shows a partly drawn frame.
+ */
+
+/* return number of framebuffer pages usable for shadow flushes*/
+static int
+fb_setpages(PSD psd)
+{
+#if MW_FBSHADOW_PAGEFLIP
+	struct fb_var_screeninfo var = fb_var;
+
+	/* shadow copy handles packed 8bpp and above only*/
+	if (psd->planes != 1 || psd->bpp < 8)
+		return 1;
+
+	/* ask for a virtual screen twice the visible height*/
+	if (var.yres_virtual < var.yres * 2) {
+		var.yres_virtual = var.yres * 2;
+		var.xoffset = var.yoffset = 0;
+		if (ioctl(fb, FBIOPUT_VSCREENINFO, &var) == -1 ||
+		    ioctl(fb, FBIOGET_VSCREENINFO, &var) == -1 ||
+		    ioctl(fb, FBIOGET_FSCREENINFO, &fb_fix) == -1 ||
+		    var.yres_virtual < var.yres * 2) {
+			EPRINTF("Can't set double height framebuffer, no page flipping\n");
+			return 1;
+		}
+		fb_var = var;
+		psd->pitch = fb_fix.line_length;
+	}
+	if (fb_fix.smem_len < psd->yres * psd->pitch * 2)
+		return 1;
+
+	/* display first page, draw second*/
+	fb_var.xoffset = fb_var.yoffset = 0;
+	if (ioctl(fb, FBIOPAN_DISPLAY, &fb_var) == -1) {
+		EPRINTF("Error panning framebuffer, no page flipping: %m\n");
+		return 1;
+	}
+	fb_backpage = 1;
+	return 2;
+#else
+	return 1;
+#endif
+}
+
+/* switch drawing to system memory shadow of mmapped framebuffer*/
+static void
+fb_openshadow(PSD psd)
+{
+	unsigned int size = psd->yres * psd->pitch;
+	unsigned char *shadow;
+
+	if (psd->planes != 1 || psd->bpp < 8)
+		return;
+	if (!(shadow = malloc(size)) || !(fb_damage = GdAllocRegion()) ||
+	    !(fb_backdamage = GdAllocRegion())) {
+		EPRINTF("No memory for shadow framebuffer, drawing direct\n");
+		free(shadow);
+		GdDestroyRegion(fb_damage);
+		fb_damage = NULL;
+		return;
+	}
+	memcpy(shadow, psd->addr, size);
+
+	fb_hwaddr = psd->addr;
+	fb_hwsize = psd->size;
+	psd->addr = shadow;
+	psd->size = size;
+	psd->flags |= PSF_DELAYUPDATE;
+#if MW_FEATURE_CURSOROVERLAY
+	psd->flags |= PSF_CURSOROVERLAY;
+#endif
+	psd->Update = fb_update;
+	psd->PreSelect = fb_preselect;
+
+	/* hidden page has nothing valid yet*/
+	if (fb_pages == 2)
+		GdAddDamageRect(&fb_backdamage, 0, 0, psd->xres, psd->yres);
+	EPRINTF("Shadow framebuffer, %d page%s\n", fb_pages, fb_pages == 2? "s": "");
+}
+
+#if MW_FBSHADOW_VSYNC
+/* wait for vertical retrace, stop trying if the driver doesn't support it*/
+static void
+fb_waitvsync(void)
+{
+#ifdef FBIO_WAITFORVSYNC
+	static int novsync;
+	__u32 crtc = 0;
+
+	if (!novsync && ioctl(fb, FBIO_WAITFORVSYNC, &crtc) == -1)
+		novsync = 1;
+#endif
+}
+#endif
+
+/* copy shadow rectangle to back page of framebuffer*/
+static void
+fb_copyrect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	int bytespp = psd->bpp >> 3;
+	unsigned char *src, *dst;
+
+	if (x < 0) {
+		width += x;
+		x = 0;
+	}
+	if (y < 0) {
+		height += y;
+		y = 0;
+	}
+	if (x + width > psd->xres)
+		width = psd->xres - x;
+	if (y + height > psd->yres)
+		height = psd->yres - y;
+	if (width <= 0 || height <= 0)
+		return;
+
+	src = psd->addr + y * psd->pitch + x * bytespp;
+	dst = fb_hwaddr + (fb_backpage * psd->yres + y) * psd->pitch + x * bytespp;
+	width *= bytespp;
+	while (--height >= 0) {
+		memcpy(dst, src, width);
+		src += psd->pitch;
+		dst += psd->pitch;
+	}
+}
+
+/* called before select(), copies damaged shadow areas to framebuffer*/
+static int
+fb_preselect(PSD psd)
+{
+	if (GdEmptyRegion(fb_damage))
+		return 0;
+
+	if (fb_pages == 2) {
+		/* back page lacks both this and the previous flush's damage*/
+		MWCLIPREGION *rgn = fb_backdamage;
+
+		GdUnionRegion(rgn, rgn, fb_damage);
+		fb_backdamage = fb_damage;
+		fb_damage = rgn;
+		GdFlushDamage(psd, fb_damage, fb_copyrect);
+
+		fb_var.yoffset = fb_backpage * psd->yres;
+		ioctl(fb, FBIOPAN_DISPLAY, &fb_var);
+		fb_backpage ^= 1;
+#if MW_FBSHADOW_VSYNC
+		/* don't write old front page until it is off screen*/
+		fb_waitvsync();
+#endif
+	} else {
+#if MW_FBSHADOW_VSYNC
+		fb_waitvsync();
+#endif
+		GdFlushDamage(psd, fb_damage, fb_copyrect);
+	}
+	return 0;
+}
+
+static void
+fb_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	GdAddDamageRect(&fb_damage, x, y, width, height);
+}
+#endif /* MW_FEATURE_FBSHADOW*/
+
 /* setup directcolor palette - required for ATI cards*/
 static void
 set_directcolor_palette(PSD psd)
@@ -35,7 +35,7 @@ SCREENDEVICE	scrdev = {
 	sdl_preselect
 };
 
-static MWCOORD upminX, upminY, upmaxX, upmaxY;	/* sdl_preselect and sdl_update*/
+static MWCLIPREGION *sdl_damage;	/* sdl_preselect and sdl_update delayed update region*/
 
 static SDL_Window *sdlWindow;
 static SDL_Renderer *sdlRenderer;
@@ -163,6 +163,9 @@ sdl_open(PSD psd)
 {
 	/* init psd and allocate framebuffer*/
 	int flags = PSF_SCREEN | PSF_ADDRMALLOC | PSF_DELAYUPDATE | PSF_CANTBLOCK;
+#if MW_FEATURE_CURSOROVERLAY
+	flags |= PSF_CURSOROVERLAY;		/* cursor composited when flushed to SDL*/
+#endif
 
 	if (!gen_initpsd(psd, MWPIXEL_FORMAT, SCREEN_WIDTH, SCREEN_HEIGHT, flags))
 		return NULL;
@@ -183,6 +186,9 @@ sdl_close(PSD psd)
 	/* free framebuffer memory */
 	free(psd->addr);
 
+	GdDestroyRegion(sdl_damage);
+	sdl_damage = NULL;
+
 	SDL_Quit();
 }
 
@@ -194,7 +200,7 @@ sdl_setpalette(PSD psd,int first,int count,MWPALENTRY *pal)
 {
 }
 
-/* update SDL from Microwindows framebuffer*/
+/* update SDL texture from Microwindows framebuffer*/
 static void
 sdl_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
@@ -221,26 +227,27 @@ sdl_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 
 	unsigned char *pixels = psd->addr + y * psd->pitch + x * (psd->bpp >> 3);
 	SDL_UpdateTexture(sdlTexture, &r, pixels, psd->pitch);
+#endif
+}
 
-	/* copy texture to display*/
+/* copy texture to display*/
+static void
+sdl_present(void)
+{
 	SDL_SetRenderDrawColor(sdlRenderer, 0x00, 0x00, 0x00, 0x00);
 	SDL_RenderClear(sdlRenderer);
 	SDL_RenderCopy(sdlRenderer, sdlTexture, NULL, NULL);
 	SDL_RenderPresent(sdlRenderer);
-#endif
 }
 
 /* called before select(), returns # pending events*/
 static int
 sdl_preselect(PSD psd)
 {
-	/* perform single blit update of aggregate update region to SDL server*/
-	if ((psd->flags & PSF_DELAYUPDATE) && (upmaxX >= 0 || upmaxY >= 0)) {
-		sdl_draw(psd, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1);
-
-		/* reset update region*/
-		upminX = upminY = MAX_MWCOORD;
-		upmaxX = upmaxY = MIN_MWCOORD;
+	/* upload each rectangle of delayed update region, then present once*/
+	if ((psd->flags & PSF_DELAYUPDATE) && sdl_damage && !GdEmptyRegion(sdl_damage)) {
+		GdFlushDamage(psd, sdl_damage, sdl_draw);
+		sdl_present();
 	}
 
 	/* return nonzero if SDL event available*/
@@ -251,12 +258,17 @@ static void
 sdl_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
 	/* window moves require delaying updates until preselect for speed*/
-	if ((psd->flags & PSF_DELAYUPDATE)) {
-			/* calc aggregate update rectangle*/
-			upminX = MWMIN(x, upminX);
-			upminY = MWMIN(y, upminY);
-			upmaxX = MWMAX(upmaxX, x+width-1);
-			upmaxY = MWMAX(upmaxY, y+height-1);
-	} else
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdAddDamageRect(&sdl_damage, x, y, width, height);
+	else {
+#if MW_FEATURE_CURSOROVERLAY
+		MWBOOL overlay = GdDrawCursorOverlay(psd, x, y, width, height);
+		sdl_draw(psd, x, y, width, height);
+		if (overlay)
+			GdEraseCursorOverlay(psd);
+#else
 		sdl_draw(psd, x, y, width, height);
+#endif
+		sdl_present();
+	}
 }
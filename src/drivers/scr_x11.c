@@ -81,7 +81,7 @@ static int x11_colormap_installed = 0;
 static XColor x11_palette[256];
 static int x11_pal_max = 0;
 
-static MWCOORD upminX, upminY, upmaxX, upmaxY;
+static MWCLIPREGION *x11_damage;	/* delayed update damage region*/
 /* called from mou_x11.c*/
 void x11_handle_event(XEvent * ev);
 int x11_setup_display(void);
@@ -573,6 +573,9 @@ X11_open(PSD psd)
 
 	/* init psd and allocate framebuffer*/
 	flags = PSF_SCREEN | PSF_ADDRMALLOC | PSF_DELAYUPDATE;
+#if MW_FEATURE_CURSOROVERLAY
+	flags |= PSF_CURSOROVERLAY;		/* cursor composited when flushed to X11*/
+#endif
 
 	if (!gen_initpsd(psd, MWPIXEL_FORMAT, x11_width, x11_height, flags))
 		return NULL;
@@ -587,6 +590,9 @@ X11_close(PSD psd)
 	/* free framebuffer memory */
 	free(psd->addr);
 
+	GdDestroyRegion(x11_damage);
+	x11_damage = NULL;
+
 	XCloseDisplay(x11_dpy);
 }
 
@@ -628,7 +634,7 @@ X11_setpalette(PSD psd, int first, int count, MWPALENTRY * pal)
 }
 
 static void
-update_from_savebits(PSD psd, unsigned int destx, unsigned int desty, int w, int h)
+update_from_savebits(PSD psd, MWCOORD destx, MWCOORD desty, MWCOORD w, MWCOORD h)
 {
 	XImage *img;
 	unsigned int x, y;
@@ -719,14 +725,9 @@ update_from_savebits(PSD psd, unsigned int destx, unsigned int desty, int w, int
 static int
 X11_preselect(PSD psd)
 {
-	/* perform single blit update of aggregate update region to X11 server*/
-	if ((psd->flags & PSF_DELAYUPDATE) && (upmaxX >= 0 || upmaxY >= 0)) {
-		update_from_savebits(psd, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1);
-
-		/* reset update region*/
-		upminX = upminY = MAX_MWCOORD;
-		upmaxX = upmaxY = MIN_MWCOORD;
-	}
+	/* blit each rectangle of delayed update region to X11 server*/
+	if (psd->flags & PSF_DELAYUPDATE)
+		GdFlushDamage(psd, x11_damage, update_from_savebits);
 
 	XFlush(x11_dpy);
 	return XPending(x11_dpy);
@@ -736,12 +737,16 @@ static void
 X11_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
 	/* window moves require delaying updates until preselect for speed*/
-	if ((psd->flags & PSF_DELAYUPDATE)) {
-			/* calc aggregate update rectangle*/
-			upminX = MWMIN(x, upminX);
-			upminY = MWMIN(y, upminY);
-			upmaxX = MWMAX(upmaxX, x+width-1);
-			upmaxY = MWMAX(upmaxY, y+height-1);
-	} else
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdAddDamageRect(&x11_damage, x, y, width, height);
+	else {
+#if MW_FEATURE_CURSOROVERLAY
+		MWBOOL overlay = GdDrawCursorOverlay(psd, x, y, width, height);
 		update_from_savebits(psd, x, y, width, height);
+		if (overlay)
+			GdEraseCursorOverlay(psd);
+#else
+		update_from_savebits(psd, x, y, width, height);
+#endif
+	}
 }
@@ -25,6 +25,9 @@ static int ttyfd = -1;		/* /dev/tty0*/
 static int visible = 1;		/* VT visible flag*/
 static struct vt_mode mode;	/* terminal mode*/
 static SUBDRIVER save;		/* saved subdriver when VT switched*/
+#if MW_FEATURE_FBSHADOW
+static int (*savepreselect)(PSD psd);	/* saved shadow flush when VT switched*/
+#endif
 
 extern SCREENDEVICE	scrdev;	/* FIXME */
 
@@ -82,6 +85,13 @@ draw_enable(void)
 
 	/* restore screen drawing functions*/
 	set_subdriver(&scrdev, &save);
+
+#if MW_FEATURE_FBSHADOW
+	/* resume shadow flushes and repaint whole screen from shadow*/
+	scrdev.PreSelect = savepreselect;
+	if (scrdev.Update)
+		scrdev.Update(&scrdev, 0, 0, scrdev.xres, scrdev.yres);
+#endif
 }
       
 static void
@@ -96,6 +106,12 @@ draw_disable(void)
 
 	/* set null driver*/
 	set_subdriver(&scrdev, &nulldriver);
+
+#if MW_FEATURE_FBSHADOW
+	/* don't flush shadow over another VT*/
+	savepreselect = scrdev.PreSelect;
+	scrdev.PreSelect = NULL;
+#endif
 }
 
 /* Timer handler used to do the VT switch at a time when not drawing */
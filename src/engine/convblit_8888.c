@@ -6,7 +6,8 @@
  * This file will need to be modified when adding a new hardware framebuffer
  * image format.
  *
- * Currently, 32bpp BGRA, 32bpp RGBA, 24bpp BGR, and 16bpp RGB565/555 are defined.
+ * Currently, 32bpp BGRA, 32bpp RGBA, 24bpp BGR, 16bpp RGB565/555 and
+ * 8bpp palette are defined.
  *
  * These routines do no range checking, clipping, or cursor
  * overwriting checks, but instead draw directly to the
@@ -32,7 +33,8 @@
 
 /*
  * Conversion blit for COPY or SRCOVER from RGBA or RGB input to
- * 32, 24 or 16bpp output, and rotate according to portrait specified.
+ * 32, 24, 16 or 8bpp output, and rotate according to portrait specified.
+ * 8bpp output is converted through the inverse colormap.
  *
  * The gcc inline mechanism can compile this function with the
  * result of no switch and few if statements, as most use constant comparisons,
@@ -48,6 +50,12 @@ static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mod
 	int dsz, dst_pitch;
 	int height, tmp;
 	int src_pitch = gc->src_pitch;
+	unsigned char *invcmap = 0;	/* set for 8bpp output only*/
+
+#if MW_FEATURE_PALETTE
+	if (DSZ == 1 && !(invcmap = GdGetInverseColormap(psd)))
+		return;
+#endif
 
 	/* compiler can optimize out switch statement and most else to constants*/
 	switch (PORTRAIT) {
@@ -107,7 +115,9 @@ static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mod
 			/* inline implementation will optimize out all but two compares in inner loop*/
 			if (mode == COPY || (alpha = s[SA]) == 255)		/* copy source*/
 			{
-				if (DSZ == 2)
+				if (DSZ == 1)
+					d[0] = invcmap[RGB2PIXEL555(s[SR], s[SG], s[SB])];
+				else if (DSZ == 2)
 				{
 					if (SSZ == 2)
 						((unsigned short *)d)[0] = ((unsigned short *)s)[0];
@@ -126,7 +136,19 @@ static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mod
 			}
 			else if (alpha != 0)							/* blend source w/dest*/
 			{
-				if (DSZ == 2) {
+				if (DSZ == 1) {
+					MWCOLORVAL c = GdGetColorRGB(psd, d[0]);
+					int r = REDVALUE(c);
+					int g = GREENVALUE(c);
+					int b = BLUEVALUE(c);
+
+					/* d += muldiv255(a, s - d)*/
+					r += muldiv255(alpha, s[SR] - r);
+					g += muldiv255(alpha, s[SG] - g);
+					b += muldiv255(alpha, s[SB] - b);
+					d[0] = invcmap[RGB2PIXEL555(r, g, b)];
+				}
+				else if (DSZ == 2) {
 					unsigned short sr = RED2PIXEL(s[SR]);
 					unsigned short sg = GREEN2PIXEL(s[SG]);
 					unsigned short sb = BLUE2PIXEL(s[SB]);
@@ -138,7 +160,7 @@ static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mod
 				}
 				else
 				{
- 					/* d += muldiv255(a, s - d)*/
+					/* d += muldiv255(a, s - d)*/
 					d[DR] += muldiv255(alpha, s[SR] - d[DR]);
 					d[DG] += muldiv255(alpha, s[SG] - d[DG]);
 					d[DB] += muldiv255(alpha, s[SB] - d[DB]);
@@ -287,3 +309,25 @@ void convblit_copy_16bpp_16bpp(PSD psd, PMWBLITPARMS gc)
 {
 	convblit_8888(psd, gc, COPY, 2, 0,0,0,-1, 2, 0,0,0,-1, psd->portrait);
 }
+
+#if MW_FEATURE_PALETTE
+/*---------- 8bpp palette output ----------*/
+
+/* Conversion blit srcover 32bpp RGBA image to 8bpp image*/
+void convblit_srcover_rgba8888_8bpp(PSD psd, PMWBLITPARMS gc)
+{
+	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 1, 0,0,0,-1, psd->portrait);
+}
+
+/* Conversion blit copy 32bpp RGBA image to 8bpp image*/
+void convblit_copy_rgba8888_8bpp(PSD psd, PMWBLITPARMS gc)
+{
+	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 1, 0,0,0,-1, psd->portrait);
+}
+
+/* Conversion blit copy 24bpp RGB image to 8bpp image*/
+void convblit_copy_rgb888_8bpp(PSD psd, PMWBLITPARMS gc)
+{
+	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 1, 0,0,0,-1, psd->portrait);
+}
+#endif
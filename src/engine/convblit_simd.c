@@ -0,0 +1,723 @@
+/*
+ * Vectorized convblit routines - SSE2/SSSE3/AVX2 and NEON kernels
+ *
+ * These routines replace the most heavily used convblit_8888.c conversion
+ * blits (RGBA srcover, RGBA/RGB copy) for non-portrait output to 32bpp BGRA,
+ * 32bpp RGBA and 16bpp RGB565 when the CPU supports it.  They are installed
+ * into the same SCREENDEVICE BlitCopyRGBA8888/BlitSrcOverRGBA8888/BlitCopyRGB888
+ * slots by convblit_simd_select(), called from set_subdriver().
+ *
+ * All kernels are bit-exact with the scalar convblit_8888() code. The scalar
+ * srcover blend d += muldiv255(a, s - d) is evaluated as
+ *		d = ((a+1)*s + (255-a)*d) >> 8
+ * which is identical for all a, s, d and fits in unsigned 16 bits, with
+ * a == 0 masked to leave the destination untouched.
+ *
+ * Portrait modes are passed through to the scalar routines.
+ */
+#include <string.h>
+#include "device.h"
+#include "convblit.h"
+#include "../drivers/fb.h"		// DRAWON macro
+
+#if MW_FEATURE_SIMD
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SIMD_X86	1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON	1
+#include <arm_neon.h>
+#endif
+
+#if MWPIXEL_FORMAT == MWPF_TRUECOLOR565
+#define SIMD_565	1			/* 16bpp kernels hardcode 5/6/5 packing*/
+#endif
+
+#if SIMD_X86 | SIMD_NEON
+
+/* convert one row of w pixels from s to d*/
+typedef void (*ROWBLITFUNC)(unsigned char *d, const unsigned char *s, int w);
+
+/* per-format row kernels, selected at runtime by convblit_simd_init*/
+static ROWBLITFUNC srcover_rgba_bgra;
+static ROWBLITFUNC srcover_rgba_rgba;
+static ROWBLITFUNC copy_rgba_bgra;
+static ROWBLITFUNC copy_rgb_bgra;
+static ROWBLITFUNC copy_rgb_rgba;
+#if SIMD_565
+static ROWBLITFUNC srcover_rgba_565;
+static ROWBLITFUNC copy_rgba_565;
+static ROWBLITFUNC copy_rgb_565;
+#endif
+
+/*---------- scalar tails, must match convblit_8888() exactly ----------*/
+
+static inline void ALWAYS_INLINE
+tail_srcover_8888(unsigned char *d, const unsigned char *s, int w, int swap)
+{
+	int DR = swap? 2: 0;
+	int DB = swap? 0: 2;
+
+	while (--w >= 0) {
+		unsigned int alpha = s[3];
+
+		if (alpha == 255) {
+			d[3] = 255;
+			d[DR] = s[0];
+			d[1] = s[1];
+			d[DB] = s[2];
+		} else if (alpha != 0) {
+			d[DR] += muldiv255(alpha, s[0] - d[DR]);
+			d[1] += muldiv255(alpha, s[1] - d[1]);
+			d[DB] += muldiv255(alpha, s[2] - d[DB]);
+			d[3] += muldiv255(alpha, 255 - d[3]);
+		}
+		d += 4;
+		s += 4;
+	}
+}
+
+static inline void ALWAYS_INLINE
+tail_copy_8888(unsigned char *d, const unsigned char *s, int w, int SSZ, int swap)
+{
+	int DR = swap? 2: 0;
+	int DB = swap? 0: 2;
+
+	while (--w >= 0) {
+		d[3] = (SSZ == 4)? s[3]: 255;
+		d[DR] = s[0];
+		d[1] = s[1];
+		d[DB] = s[2];
+		d += 4;
+		s += SSZ;
+	}
+}
+
+#if SIMD_565
+static inline void ALWAYS_INLINE
+tail_srcover_565(unsigned char *d, const unsigned char *s, int w)
+{
+	while (--w >= 0) {
+		unsigned int alpha = s[3];
+
+		if (alpha == 255)
+			((unsigned short *)d)[0] = RGB2PIXEL565(s[0], s[1], s[2]);
+		else if (alpha != 0) {
+			unsigned short sr = RED2PIXEL565(s[0]);
+			unsigned short sg = GREEN2PIXEL565(s[1]);
+			unsigned short sb = BLUE2PIXEL565(s[2]);
+			alpha = 255 - alpha + 1;
+			((unsigned short *)d)[0] =
+				muldiv255_rgb565(((unsigned short *)d)[0], sr, sg, sb, alpha);
+		}
+		d += 2;
+		s += 4;
+	}
+}
+
+static inline void ALWAYS_INLINE
+tail_copy_565(unsigned char *d, const unsigned char *s, int w, int SSZ)
+{
+	while (--w >= 0) {
+		((unsigned short *)d)[0] = RGB2PIXEL565(s[0], s[1], s[2]);
+		d += 2;
+		s += SSZ;
+	}
+}
+#endif /* SIMD_565*/
+
+#if SIMD_X86
+/*---------- SSE2 ----------*/
+
+/* swap bytes 0 and 2 of each 32-bit pixel (RGBA <-> BGRA)*/
+static inline __m128i ALWAYS_INLINE
+sse2_swaprb(__m128i v)
+{
+	__m128i ga = _mm_and_si128(v, _mm_set1_epi32(0xff00ff00));
+	__m128i r = _mm_and_si128(v, _mm_set1_epi32(0x000000ff));
+	__m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), _mm_set1_epi32(0x000000ff));
+	return _mm_or_si128(ga, _mm_or_si128(_mm_slli_epi32(r, 16), b));
+}
+
+/* blend 4 RGBA source pixels over 4 destination pixels*/
+static inline __m128i ALWAYS_INLINE
+sse2_srcover4(__m128i s, __m128i d, int swap)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i a32 = _mm_srli_epi32(s, 24);
+	__m128i a16 = _mm_or_si128(a32, _mm_slli_epi32(a32, 16));
+	__m128i alo = _mm_unpacklo_epi32(a16, a16);		/* a0 x4, a1 x4*/
+	__m128i ahi = _mm_unpackhi_epi32(a16, a16);		/* a2 x4, a3 x4*/
+	__m128i one = _mm_set1_epi16(1);
+	__m128i c255 = _mm_set1_epi16(255);
+	__m128i slo, shi, dlo, dhi, rlo, rhi, res, keep;
+
+	if (swap)
+		s = sse2_swaprb(s);
+	s = _mm_or_si128(s, _mm_set1_epi32(0xff000000));	/* d[A] += muldiv255(a, 255 - d[A])*/
+
+	slo = _mm_unpacklo_epi8(s, zero);
+	shi = _mm_unpackhi_epi8(s, zero);
+	dlo = _mm_unpacklo_epi8(d, zero);
+	dhi = _mm_unpackhi_epi8(d, zero);
+
+	/* (a+1)*s + (255-a)*d*/
+	rlo = _mm_add_epi16(_mm_mullo_epi16(slo, _mm_add_epi16(alo, one)),
+		_mm_mullo_epi16(dlo, _mm_sub_epi16(c255, alo)));
+	rhi = _mm_add_epi16(_mm_mullo_epi16(shi, _mm_add_epi16(ahi, one)),
+		_mm_mullo_epi16(dhi, _mm_sub_epi16(c255, ahi)));
+	res = _mm_packus_epi16(_mm_srli_epi16(rlo, 8), _mm_srli_epi16(rhi, 8));
+
+	/* alpha 0 leaves destination untouched*/
+	keep = _mm_cmpeq_epi32(a32, zero);
+	return _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, res));
+}
+
+static inline void ALWAYS_INLINE
+sse2_srcover_8888(unsigned char *d, const unsigned char *s, int w, int swap)
+{
+	while (w >= 4) {
+		__m128i sv = _mm_loadu_si128((const __m128i *)s);
+		__m128i dv = _mm_loadu_si128((const __m128i *)d);
+		_mm_storeu_si128((__m128i *)d, sse2_srcover4(sv, dv, swap));
+		d += 16;
+		s += 16;
+		w -= 4;
+	}
+	tail_srcover_8888(d, s, w, swap);
+}
+
+static void sse2_srcover_rgba_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	sse2_srcover_8888(d, s, w, 1);
+}
+
+static void sse2_srcover_rgba_rgba(unsigned char *d, const unsigned char *s, int w)
+{
+	sse2_srcover_8888(d, s, w, 0);
+}
+
+static void sse2_copy_rgba_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	while (w >= 4) {
+		__m128i sv = _mm_loadu_si128((const __m128i *)s);
+		_mm_storeu_si128((__m128i *)d, sse2_swaprb(sv));
+		d += 16;
+		s += 16;
+		w -= 4;
+	}
+	tail_copy_8888(d, s, w, 4, 1);
+}
+
+#if SIMD_565
+/* pack 8 RGBA pixels held in two registers into separate 16-bit r, g, b, a lanes*/
+static inline void ALWAYS_INLINE
+sse2_split8(__m128i p0, __m128i p1, __m128i *r, __m128i *g, __m128i *b, __m128i *a)
+{
+	__m128i m = _mm_set1_epi32(0xff);
+
+	*r = _mm_packs_epi32(_mm_and_si128(p0, m), _mm_and_si128(p1, m));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), m),
+		_mm_and_si128(_mm_srli_epi32(p1, 8), m));
+	*b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), m),
+		_mm_and_si128(_mm_srli_epi32(p1, 16), m));
+	*a = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+}
+
+/* RGB2PIXEL565 of 8 pixels*/
+static inline __m128i ALWAYS_INLINE
+sse2_pack565(__m128i r, __m128i g, __m128i b)
+{
+	__m128i pr = _mm_slli_epi16(_mm_and_si128(r, _mm_set1_epi16(0xf8)), 8);
+	__m128i pg = _mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0xfc)), 3);
+	__m128i pb = _mm_srli_epi16(b, 3);
+	return _mm_or_si128(pr, _mm_or_si128(pg, pb));
+}
+
+/*
+ * muldiv255_rgb565 of 8 pixels.  Each component reduces to
+ * ((((dc - sc) * as) >> 8) + sc) & mask computed at component width,
+ * which keeps all products within signed 16 bits.
+ */
+static inline __m128i ALWAYS_INLINE
+sse2_srcover565(__m128i dv, __m128i r, __m128i g, __m128i b, __m128i a)
+{
+	__m128i as = _mm_sub_epi16(_mm_set1_epi16(256), a);
+	__m128i m5 = _mm_set1_epi16(0x1f);
+	__m128i m6 = _mm_set1_epi16(0x3f);
+	__m128i sr = _mm_srli_epi16(r, 3);
+	__m128i sg = _mm_srli_epi16(g, 2);
+	__m128i sb = _mm_srli_epi16(b, 3);
+	__m128i dr = _mm_srli_epi16(dv, 11);
+	__m128i dg = _mm_and_si128(_mm_srli_epi16(dv, 5), m6);
+	__m128i db = _mm_and_si128(dv, m5);
+	__m128i blend, copy, keep, full;
+
+	dr = _mm_and_si128(_mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(dr, sr), as), 8), sr), m5);
+	dg = _mm_and_si128(_mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(dg, sg), as), 8), sg), m6);
+	db = _mm_and_si128(_mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(db, sb), as), 8), sb), m5);
+	blend = _mm_or_si128(_mm_slli_epi16(dr, 11), _mm_or_si128(_mm_slli_epi16(dg, 5), db));
+
+	copy = sse2_pack565(r, g, b);
+	full = _mm_cmpeq_epi16(a, _mm_set1_epi16(255));
+	keep = _mm_cmpeq_epi16(a, _mm_setzero_si128());
+	blend = _mm_or_si128(_mm_and_si128(full, copy), _mm_andnot_si128(full, blend));
+	return _mm_or_si128(_mm_and_si128(keep, dv), _mm_andnot_si128(keep, blend));
+}
+
+static void sse2_srcover_rgba_565(unsigned char *d, const unsigned char *s, int w)
+{
+	__m128i r, g, b, a;
+
+	while (w >= 8) {
+		__m128i dv = _mm_loadu_si128((const __m128i *)d);
+		sse2_split8(_mm_loadu_si128((const __m128i *)s),
+			_mm_loadu_si128((const __m128i *)(s + 16)), &r, &g, &b, &a);
+		_mm_storeu_si128((__m128i *)d, sse2_srcover565(dv, r, g, b, a));
+		d += 16;
+		s += 32;
+		w -= 8;
+	}
+	tail_srcover_565(d, s, w);
+}
+
+static void sse2_copy_rgba_565(unsigned char *d, const unsigned char *s, int w)
+{
+	__m128i r, g, b, a;
+
+	while (w >= 8) {
+		sse2_split8(_mm_loadu_si128((const __m128i *)s),
+			_mm_loadu_si128((const __m128i *)(s + 16)), &r, &g, &b, &a);
+		_mm_storeu_si128((__m128i *)d, sse2_pack565(r, g, b));
+		d += 16;
+		s += 32;
+		w -= 8;
+	}
+	tail_copy_565(d, s, w, 4);
+}
+#endif /* SIMD_565*/
+
+/*---------- SSSE3 (pshufb for 24bpp source) ----------*/
+
+/* expand 4 packed RGB pixels to RGBA or BGRA with alpha 255*/
+__attribute__((target("ssse3")))
+static inline __m128i
+ssse3_expand_rgb(__m128i v, int swap)
+{
+	__m128i shuf = swap?
+		_mm_setr_epi8(2,1,0,-1, 5,4,3,-1, 8,7,6,-1, 11,10,9,-1):
+		_mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+	return _mm_or_si128(_mm_shuffle_epi8(v, shuf), _mm_set1_epi32(0xff000000));
+}
+
+/* loads 16 bytes to convert 12, so stop while at least 4 source bytes remain*/
+__attribute__((target("ssse3")))
+static void ssse3_copy_rgb_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	while (w >= 6) {
+		__m128i sv = _mm_loadu_si128((const __m128i *)s);
+		_mm_storeu_si128((__m128i *)d, ssse3_expand_rgb(sv, 1));
+		d += 16;
+		s += 12;
+		w -= 4;
+	}
+	tail_copy_8888(d, s, w, 3, 1);
+}
+
+__attribute__((target("ssse3")))
+static void ssse3_copy_rgb_rgba(unsigned char *d, const unsigned char *s, int w)
+{
+	while (w >= 6) {
+		__m128i sv = _mm_loadu_si128((const __m128i *)s);
+		_mm_storeu_si128((__m128i *)d, ssse3_expand_rgb(sv, 0));
+		d += 16;
+		s += 12;
+		w -= 4;
+	}
+	tail_copy_8888(d, s, w, 3, 0);
+}
+
+#if SIMD_565
+__attribute__((target("ssse3")))
+static void ssse3_copy_rgb_565(unsigned char *d, const unsigned char *s, int w)
+{
+	__m128i r, g, b, a;
+
+	while (w >= 10) {
+		__m128i p0 = ssse3_expand_rgb(_mm_loadu_si128((const __m128i *)s), 0);
+		__m128i p1 = ssse3_expand_rgb(_mm_loadu_si128((const __m128i *)(s + 12)), 0);
+		sse2_split8(p0, p1, &r, &g, &b, &a);
+		_mm_storeu_si128((__m128i *)d, sse2_pack565(r, g, b));
+		d += 16;
+		s += 24;
+		w -= 8;
+	}
+	tail_copy_565(d, s, w, 3);
+}
+#endif
+
+/*---------- AVX2 (8 pixel srcover) ----------*/
+
+__attribute__((target("avx2")))
+static inline void
+avx2_srcover_8888(unsigned char *d, const unsigned char *s, int w, int swap)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi16(1);
+	__m256i c255 = _mm256_set1_epi16(255);
+	__m256i rbswap = _mm256_setr_epi8(
+		2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15,
+		2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+	__m256i ashuf = _mm256_setr_epi8(
+		3,-1,3,-1, 3,-1,3,-1, 7,-1,7,-1, 7,-1,7,-1,
+		3,-1,3,-1, 3,-1,3,-1, 7,-1,7,-1, 7,-1,7,-1);
+
+	while (w >= 8) {
+		__m256i sv = _mm256_loadu_si256((const __m256i *)s);
+		__m256i dv = _mm256_loadu_si256((const __m256i *)d);
+		__m256i a32 = _mm256_srli_epi32(sv, 24);
+		__m256i ss = swap? _mm256_shuffle_epi8(sv, rbswap): sv;
+		__m256i slo, shi, dlo, dhi, alo, ahi, rlo, rhi, res, keep;
+
+		/* alpha replicated to 16-bit lanes within each 128-bit half*/
+		alo = _mm256_shuffle_epi8(sv, ashuf);
+		ahi = _mm256_shuffle_epi8(_mm256_srli_si256(sv, 8), ashuf);
+		ss = _mm256_or_si256(ss, _mm256_set1_epi32(0xff000000));
+
+		slo = _mm256_unpacklo_epi8(ss, zero);
+		shi = _mm256_unpackhi_epi8(ss, zero);
+		dlo = _mm256_unpacklo_epi8(dv, zero);
+		dhi = _mm256_unpackhi_epi8(dv, zero);
+
+		rlo = _mm256_add_epi16(_mm256_mullo_epi16(slo, _mm256_add_epi16(alo, one)),
+			_mm256_mullo_epi16(dlo, _mm256_sub_epi16(c255, alo)));
+		rhi = _mm256_add_epi16(_mm256_mullo_epi16(shi, _mm256_add_epi16(ahi, one)),
+			_mm256_mullo_epi16(dhi, _mm256_sub_epi16(c255, ahi)));
+		res = _mm256_packus_epi16(_mm256_srli_epi16(rlo, 8), _mm256_srli_epi16(rhi, 8));
+
+		keep = _mm256_cmpeq_epi32(a32, zero);
+		_mm256_storeu_si256((__m256i *)d, _mm256_blendv_epi8(res, dv, keep));
+		d += 32;
+		s += 32;
+		w -= 8;
+	}
+	tail_srcover_8888(d, s, w, swap);
+}
+
+__attribute__((target("avx2")))
+static void avx2_srcover_rgba_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	avx2_srcover_8888(d, s, w, 1);
+}
+
+__attribute__((target("avx2")))
+static void avx2_srcover_rgba_rgba(unsigned char *d, const unsigned char *s, int w)
+{
+	avx2_srcover_8888(d, s, w, 0);
+}
+#endif /* SIMD_X86*/
+
+#if SIMD_NEON
+/*---------- NEON ----------*/
+
+static inline void ALWAYS_INLINE
+neon_srcover_8888(unsigned char *d, const unsigned char *s, int w, int swap)
+{
+	int DR = swap? 2: 0;
+	int DB = swap? 0: 2;
+	uint8x16_t zero = vdupq_n_u8(0);
+	uint8x16_t c255 = vdupq_n_u8(255);
+
+	while (w >= 16) {
+		uint8x16x4_t sv = vld4q_u8(s);
+		uint8x16x4_t dv = vld4q_u8(d);
+		uint8x16_t a = sv.val[3];
+		uint8x16_t ia = vsubq_u8(c255, a);
+		uint16x8_t a1lo = vaddw_u8(vdupq_n_u16(1), vget_low_u8(a));
+		uint16x8_t a1hi = vaddw_u8(vdupq_n_u16(1), vget_high_u8(a));
+		uint8x16_t keep = vceqq_u8(a, zero);
+		uint8x16x4_t rv;
+		int i;
+
+		sv.val[3] = c255;			/* d[A] += muldiv255(a, 255 - d[A])*/
+		for (i = 0; i < 4; i++) {
+			int si = (i == DR)? 0: (i == DB)? 2: i;
+			uint8x16_t sc = sv.val[si];
+			uint8x16_t dc = dv.val[i];
+			uint16x8_t lo = vmlal_u8(vmulq_u16(vmovl_u8(vget_low_u8(sc)), a1lo),
+				vget_low_u8(dc), vget_low_u8(ia));
+			uint16x8_t hi = vmlal_u8(vmulq_u16(vmovl_u8(vget_high_u8(sc)), a1hi),
+				vget_high_u8(dc), vget_high_u8(ia));
+			rv.val[i] = vbslq_u8(keep, dc, vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+		}
+		vst4q_u8(d, rv);
+		d += 64;
+		s += 64;
+		w -= 16;
+	}
+	tail_srcover_8888(d, s, w, swap);
+}
+
+static void neon_srcover_rgba_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	neon_srcover_8888(d, s, w, 1);
+}
+
+static void neon_srcover_rgba_rgba(unsigned char *d, const unsigned char *s, int w)
+{
+	neon_srcover_8888(d, s, w, 0);
+}
+
+static void neon_copy_rgba_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	while (w >= 16) {
+		uint8x16x4_t v = vld4q_u8(s);
+		uint8x16_t tmp = v.val[0];
+		v.val[0] = v.val[2];
+		v.val[2] = tmp;
+		vst4q_u8(d, v);
+		d += 64;
+		s += 64;
+		w -= 16;
+	}
+	tail_copy_8888(d, s, w, 4, 1);
+}
+
+static inline void ALWAYS_INLINE
+neon_copy_rgb_8888(unsigned char *d, const unsigned char *s, int w, int swap)
+{
+	while (w >= 16) {
+		uint8x16x3_t sv = vld3q_u8(s);
+		uint8x16x4_t dv;
+		dv.val[0] = sv.val[swap? 2: 0];
+		dv.val[1] = sv.val[1];
+		dv.val[2] = sv.val[swap? 0: 2];
+		dv.val[3] = vdupq_n_u8(255);
+		vst4q_u8(d, dv);
+		d += 64;
+		s += 48;
+		w -= 16;
+	}
+	tail_copy_8888(d, s, w, 3, swap);
+}
+
+static void neon_copy_rgb_bgra(unsigned char *d, const unsigned char *s, int w)
+{
+	neon_copy_rgb_8888(d, s, w, 1);
+}
+
+static void neon_copy_rgb_rgba(unsigned char *d, const unsigned char *s, int w)
+{
+	neon_copy_rgb_8888(d, s, w, 0);
+}
+
+#if SIMD_565
+/* RGB2PIXEL565 of 8 pixels*/
+static inline uint16x8_t ALWAYS_INLINE
+neon_pack565(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t p = vshlq_n_u16(vmovl_u8(vand_u8(r, vdup_n_u8(0xf8))), 8);
+	p = vorrq_u16(p, vshlq_n_u16(vmovl_u8(vand_u8(g, vdup_n_u8(0xfc))), 3));
+	return vorrq_u16(p, vmovl_u8(vshr_n_u8(b, 3)));
+}
+
+static void neon_srcover_rgba_565(unsigned char *d, const unsigned char *s, int w)
+{
+	int16x8_t m5 = vdupq_n_s16(0x1f);
+	int16x8_t m6 = vdupq_n_s16(0x3f);
+
+	while (w >= 8) {
+		uint8x8x4_t sv = vld4_u8(s);
+		uint16x8_t dv = vld1q_u16((const uint16_t *)d);
+		int16x8_t as = vsubq_s16(vdupq_n_s16(256), vreinterpretq_s16_u16(vmovl_u8(sv.val[3])));
+		int16x8_t sr = vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(sv.val[0], 3)));
+		int16x8_t sg = vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(sv.val[1], 2)));
+		int16x8_t sb = vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(sv.val[2], 3)));
+		int16x8_t dr = vreinterpretq_s16_u16(vshrq_n_u16(dv, 11));
+		int16x8_t dg = vandq_s16(vreinterpretq_s16_u16(vshrq_n_u16(dv, 5)), m6);
+		int16x8_t db = vandq_s16(vreinterpretq_s16_u16(dv), m5);
+		uint16x8_t blend, full, keep;
+
+		dr = vandq_s16(vaddq_s16(vshrq_n_s16(vmulq_s16(vsubq_s16(dr, sr), as), 8), sr), m5);
+		dg = vandq_s16(vaddq_s16(vshrq_n_s16(vmulq_s16(vsubq_s16(dg, sg), as), 8), sg), m6);
+		db = vandq_s16(vaddq_s16(vshrq_n_s16(vmulq_s16(vsubq_s16(db, sb), as), 8), sb), m5);
+		blend = vreinterpretq_u16_s16(vorrq_s16(vshlq_n_s16(dr, 11),
+			vorrq_s16(vshlq_n_s16(dg, 5), db)));
+
+		full = vmovl_u8(vceq_u8(sv.val[3], vdup_n_u8(255)));
+		full = vorrq_u16(full, vshlq_n_u16(full, 8));
+		keep = vmovl_u8(vceq_u8(sv.val[3], vdup_n_u8(0)));
+		keep = vorrq_u16(keep, vshlq_n_u16(keep, 8));
+		blend = vbslq_u16(full, neon_pack565(sv.val[0], sv.val[1], sv.val[2]), blend);
+		vst1q_u16((uint16_t *)d, vbslq_u16(keep, dv, blend));
+		d += 16;
+		s += 32;
+		w -= 8;
+	}
+	tail_srcover_565(d, s, w);
+}
+
+static void neon_copy_rgba_565(unsigned char *d, const unsigned char *s, int w)
+{
+	while (w >= 8) {
+		uint8x8x4_t sv = vld4_u8(s);
+		vst1q_u16((uint16_t *)d, neon_pack565(sv.val[0], sv.val[1], sv.val[2]));
+		d += 16;
+		s += 32;
+		w -= 8;
+	}
+	tail_copy_565(d, s, w, 4);
+}
+
+static void neon_copy_rgb_565(unsigned char *d, const unsigned char *s, int w)
+{
+	while (w >= 8) {
+		uint8x8x3_t sv = vld3_u8(s);
+		vst1q_u16((uint16_t *)d, neon_pack565(sv.val[0], sv.val[1], sv.val[2]));
+		d += 16;
+		s += 24;
+		w -= 8;
+	}
+	tail_copy_565(d, s, w, 3);
+}
+#endif /* SIMD_565*/
+#endif /* SIMD_NEON*/
+
+/* select best row kernels for this cpu, once*/
+static void
+convblit_simd_init(void)
+{
+	static int inited;
+
+	if (inited)
+		return;
+	inited = 1;
+
+#if SIMD_X86
+	srcover_rgba_bgra = sse2_srcover_rgba_bgra;
+	srcover_rgba_rgba = sse2_srcover_rgba_rgba;
+	copy_rgba_bgra = sse2_copy_rgba_bgra;
+#if SIMD_565
+	srcover_rgba_565 = sse2_srcover_rgba_565;
+	copy_rgba_565 = sse2_copy_rgba_565;
+#endif
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3")) {
+		copy_rgb_bgra = ssse3_copy_rgb_bgra;
+		copy_rgb_rgba = ssse3_copy_rgb_rgba;
+#if SIMD_565
+		copy_rgb_565 = ssse3_copy_rgb_565;
+#endif
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		srcover_rgba_bgra = avx2_srcover_rgba_bgra;
+		srcover_rgba_rgba = avx2_srcover_rgba_rgba;
+	}
+#endif /* SIMD_X86*/
+
+#if SIMD_NEON
+	srcover_rgba_bgra = neon_srcover_rgba_bgra;
+	srcover_rgba_rgba = neon_srcover_rgba_rgba;
+	copy_rgba_bgra = neon_copy_rgba_bgra;
+	copy_rgb_bgra = neon_copy_rgb_bgra;
+	copy_rgb_rgba = neon_copy_rgb_rgba;
+#if SIMD_565
+	srcover_rgba_565 = neon_srcover_rgba_565;
+	copy_rgba_565 = neon_copy_rgba_565;
+	copy_rgb_565 = neon_copy_rgb_565;
+#endif
+#endif /* SIMD_NEON*/
+}
+
+/* run a row kernel over the blit rectangle, non-portrait only*/
+static void
+simd_convblit(PSD psd, PMWBLITPARMS gc, ROWBLITFUNC rowblit, int SSZ, int DSZ)
+{
+	unsigned char *src, *dst;
+	int height = gc->height;
+
+	src = ((unsigned char *)gc->data)     + gc->srcy * gc->src_pitch + gc->srcx * SSZ;
+	dst = ((unsigned char *)gc->data_out) + gc->dsty * gc->dst_pitch + gc->dstx * DSZ;
+
+	DRAWON;
+	while (--height >= 0) {
+		rowblit(dst, src, gc->width);
+		src += gc->src_pitch;
+		dst += gc->dst_pitch;
+	}
+	DRAWOFF;
+
+	/* update screen bits if driver requires it*/
+	if (psd->Update)
+		psd->Update(psd, gc->dstx, gc->dsty, gc->width, gc->height);
+}
+
+/* generate SCREENDEVICE entry point falling back to scalar in portrait modes*/
+#define SIMD_CONVBLIT(name, rowblit, SSZ, DSZ) \
+static void simd_##name(PSD psd, PMWBLITPARMS gc) \
+{ \
+	if (psd->portrait != MWPORTRAIT_NONE) \
+		convblit_##name(psd, gc); \
+	else simd_convblit(psd, gc, rowblit, SSZ, DSZ); \
+}
+
+SIMD_CONVBLIT(srcover_rgba8888_bgra8888, srcover_rgba_bgra, 4, 4)
+SIMD_CONVBLIT(copy_rgba8888_bgra8888,    copy_rgba_bgra,    4, 4)
+SIMD_CONVBLIT(copy_rgb888_bgra8888,      copy_rgb_bgra,     3, 4)
+SIMD_CONVBLIT(srcover_rgba8888_rgba8888, srcover_rgba_rgba, 4, 4)
+SIMD_CONVBLIT(copy_rgb888_rgba8888,      copy_rgb_rgba,     3, 4)
+#if SIMD_565
+SIMD_CONVBLIT(srcover_rgba8888_16bpp,    srcover_rgba_565,  4, 2)
+SIMD_CONVBLIT(copy_rgba8888_16bpp,       copy_rgba_565,     4, 2)
+SIMD_CONVBLIT(copy_rgb888_16bpp,         copy_rgb_565,      3, 2)
+#endif
+
+/* return vectorized replacement for scalar conversion blit, if available*/
+static MWBLITFUNC
+simd_lookup(MWBLITFUNC f)
+{
+#define LOOKUP(name, rowblit) \
+	if (f == convblit_##name && rowblit) return simd_##name
+
+	if (!f)
+		return f;
+	LOOKUP(srcover_rgba8888_bgra8888, srcover_rgba_bgra);
+	LOOKUP(copy_rgba8888_bgra8888, copy_rgba_bgra);
+	LOOKUP(copy_rgb888_bgra8888, copy_rgb_bgra);
+	LOOKUP(srcover_rgba8888_rgba8888, srcover_rgba_rgba);
+	LOOKUP(copy_rgb888_rgba8888, copy_rgb_rgba);
+#if SIMD_565
+	LOOKUP(srcover_rgba8888_16bpp, srcover_rgba_565);
+	LOOKUP(copy_rgba8888_16bpp, copy_rgba_565);
+	LOOKUP(copy_rgb888_16bpp, copy_rgb_565);
+#endif
+	return f;
+#undef LOOKUP
+}
+
+/*
+ * Replace scalar RGBA/RGB conversion blits in screen device
+ * with vectorized versions supported by the running cpu.
+ */
+void
+convblit_simd_select(PSD psd)
+{
+	convblit_simd_init();
+
+	psd->BlitCopyRGBA8888    = simd_lookup(psd->BlitCopyRGBA8888);
+	psd->BlitSrcOverRGBA8888 = simd_lookup(psd->BlitSrcOverRGBA8888);
+	psd->BlitCopyRGB888      = simd_lookup(psd->BlitCopyRGB888);
+}
+
+#else /* !(SIMD_X86 | SIMD_NEON)*/
+
+void
+convblit_simd_select(PSD psd)
+{
+}
+
+#endif /* SIMD_X86 | SIMD_NEON*/
+#endif /* MW_FEATURE_SIMD*/
@@ -558,7 +558,7 @@ GdStretchBlit(PSD dstpsd, MWCOORD dx1, MWCOORD dy1, MWCOORD dx2,
 			parms.src_y_step_one = MWSIGN(y_numerator);
 			parms.err_y_step = MWABS(y_numerator) - MWABS(parms.src_y_step) * y_denominator;
 
-			convblit(dstpsd, &parms);
+			GdTileBlit(dstpsd, &parms, convblit, TRUE);
 		}
 		++prc;
 	}
@@ -603,7 +603,7 @@ GdSetForegroundColor(psd, MWRGB(128,64,0));	/* brown*/
 GdFillRect(psd, gc->dstx, gc->dsty, gc->width, gc->height);
 usleep(200000);
 #endif
-		convblit(psd, gc);
+		GdTileBlit(psd, gc, convblit, FALSE);
 		GdFixCursor(psd);
 		if (checksrc)
 			GdFixCursor(gc->srcpsd);
@@ -657,7 +657,7 @@ GdSetForegroundColor(psd, MWRGB(128,64,0));	/* brown*/
 GdFillRect(psd, gc->dstx, gc->dsty, gc->width, gc->height);
 usleep(200000);
 #endif
-			convblit(psd, gc);
+			GdTileBlit(psd, gc, convblit, FALSE);
 		}
 		prc++;
 	}
@@ -261,3 +261,55 @@ GdClipArea(PSD psd,MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2)
   }
   return CLIP_PARTIAL;
 }
+
+/**
+ * Draw the visible parts of a horizontal line from x1 to and including x2,
+ * using the clip cache rectangle to skip runs of equally clipped points.
+ * The cursor must already have been checked by the caller.
+ *
+ * @param psd Drawing surface.
+ * @param x1 Left X co-ordinate, <= x2.
+ * @param x2 Right X co-ordinate.
+ * @param y Y co-ordinate.
+ * @param c Pixel value.
+ */
+void
+GdClipDrawRow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c)
+{
+  MWCOORD temp;
+
+  while (x1 <= x2) {
+	MWBOOL visible = GdClipPoint(psd, x1, y);
+
+	temp = MWMIN(clipmaxx, x2);
+	if (visible)
+		psd->DrawHorzLine(psd, x1, temp, y, c);
+	x1 = temp + 1;
+  }
+}
+
+/**
+ * Draw the visible parts of a vertical line from y1 to and including y2,
+ * using the clip cache rectangle to skip runs of equally clipped points.
+ * The cursor must already have been checked by the caller.
+ *
+ * @param psd Drawing surface.
+ * @param x X co-ordinate.
+ * @param y1 Top Y co-ordinate, <= y2.
+ * @param y2 Bottom Y co-ordinate.
+ * @param c Pixel value.
+ */
+void
+GdClipDrawCol(PSD psd, MWCOORD x, MWCOORD y1, MWCOORD y2, MWPIXELVAL c)
+{
+  MWCOORD temp;
+
+  while (y1 <= y2) {
+	MWBOOL visible = GdClipPoint(psd, x, y1);
+
+	temp = MWMIN(clipmaxy, y2);
+	if (visible)
+		psd->DrawVertLine(psd, x, y1, temp, c);
+	y1 = temp + 1;
+  }
+}
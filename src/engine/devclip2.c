@@ -20,6 +20,9 @@ MWCOORD clipmaxy;		/* maximum y value of cache rectangle */
 static MWBOOL	clipresult;	/* whether clip rectangle is plottable */
 MWCLIPREGION *clipregion = NULL;
 
+/* band of clip rectangles found by last clipfindband*/
+static MWRECT *bandstart, *bandend;
+
 /**
  * Set a clip region for future drawing actions.
  * Each pixel will be drawn only if lies in one or more of the contained
@@ -40,6 +43,7 @@ GdSetClipRegion(PSD psd, MWCLIPREGION *reg)
 	  reg = GdAllocRegion();
 
   clipregion = reg;
+  bandstart = bandend = NULL;
 
 
 #if 0
@@ -259,6 +263,146 @@ GdClipArea(PSD psd,MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2)
   return CLIP_PARTIAL;
 }
 
+/* return first clip rectangle in the band containing or below y, and set
+ * bandstart and bandend to that band.  Rectangles are sorted in y-x bands,
+ * so band bottoms are ascending and can be binary searched.
+ */
+static MWRECT *
+clipfindband(MWCOORD y)
+{
+	MWRECT *rp = clipregion->rects;
+	MWRECT *end = rp + clipregion->numRects;
+	int lo, hi;
+
+	/* check the last band first, lines often stay within a band*/
+	if (bandstart && bandstart < end &&
+	    y >= bandstart->top && y < bandstart->bottom)
+		return bandstart;
+
+	lo = 0;
+	hi = clipregion->numRects;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (rp[mid].bottom <= y)
+			lo = mid + 1;
+		else hi = mid;
+	}
+	bandstart = bandend = rp + lo;
+	while (bandend < end && bandend->top == bandstart->top)
+		bandend++;
+	return bandstart;
+}
+
+/**
+ * Draw the visible parts of a horizontal line from x1 to and including x2,
+ * intersecting it once with the clip region rather than clipping each span
+ * with GdClipPoint.  The cursor must already have been checked by the caller.
+ *
+ * @param psd Drawing surface
+ * @param x1 Left X co-ordinate, <= x2
+ * @param x2 Right X co-ordinate
+ * @param y Y co-ordinate
+ * @param c Pixel value
+ */
+void
+GdClipDrawRow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c)
+{
+  MWRECT *rp, *end;
+
+  if (y < 0 || y >= psd->yvirtres)
+	return;
+  if (x1 < 0)
+	x1 = 0;
+  if (x2 >= psd->xvirtres)
+	x2 = psd->xvirtres - 1;
+
+  rp = clipfindband(y);
+  end = bandend;
+  if (rp >= end || rp->top > y)
+	return;
+
+  /* rectangles in a band are sorted by x, find first one ending after x1*/
+  if (end - rp > 4) {
+	MWRECT *lo = rp, *hi = end;
+	while (lo < hi) {
+		MWRECT *mid = lo + (hi - lo) / 2;
+		if (mid->right <= x1)
+			lo = mid + 1;
+		else hi = mid;
+	}
+	rp = lo;
+  }
+  for (; rp < end && rp->left <= x2; rp++) {
+	if (rp->right > x1) {
+		MWCOORD left = MWMAX(rp->left, x1);
+		MWCOORD right = MWMIN(rp->right - 1, x2);
+
+		if (left == right)
+			psd->DrawPixel(psd, left, y, c);
+		else psd->DrawHorzLine(psd, left, right, y, c);
+	}
+  }
+}
+
+/**
+ * Draw the visible parts of a vertical line from y1 to and including y2,
+ * intersecting it once with the clip region.  Visible parts of adjacent
+ * bands are joined.  The cursor must already have been checked by the caller.
+ *
+ * @param psd Drawing surface
+ * @param x X co-ordinate
+ * @param y1 Top Y co-ordinate, <= y2
+ * @param y2 Bottom Y co-ordinate
+ * @param c Pixel value
+ */
+void
+GdClipDrawCol(PSD psd, MWCOORD x, MWCOORD y1, MWCOORD y2, MWPIXELVAL c)
+{
+  MWRECT *rp, *end;
+  MWCOORD top, bottom;
+  MWCOORD spantop = 0, spanbottom = -2;	/* pending visible span*/
+  MWBOOL visible;
+
+  if (x < 0 || x >= psd->xvirtres)
+	return;
+  if (y1 < 0)
+	y1 = 0;
+  if (y2 >= psd->yvirtres)
+	y2 = psd->yvirtres - 1;
+  if (y1 > y2)
+	return;
+
+  end = clipregion->rects + clipregion->numRects;
+  rp = clipfindband(y1);
+  while (rp < end && rp->top <= y2) {
+	top = rp->top;
+	bottom = rp->bottom;
+	visible = FALSE;
+	for (; rp < end && rp->top == top; rp++) {
+		if (x >= rp->left && x < rp->right)
+			visible = TRUE;
+	}
+	if (!visible)
+		continue;
+
+	top = MWMAX(top, y1);
+	bottom = MWMIN(bottom - 1, y2);
+	if (top == spanbottom + 1)
+		spanbottom = bottom;
+	else {
+		if (spanbottom >= spantop)
+			psd->DrawVertLine(psd, x, spantop, spanbottom, c);
+		spantop = top;
+		spanbottom = bottom;
+	}
+  }
+  if (spanbottom >= spantop) {
+	if (spantop == spanbottom)
+		psd->DrawPixel(psd, x, spantop, c);
+	else psd->DrawVertLine(psd, x, spantop, spanbottom, c);
+  }
+}
+
 #if DEBUG
 void
 GdPrintClipRects(PMWBLITPARMS gc)
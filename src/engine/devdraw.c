@@ -174,6 +174,63 @@ GdPoint(PSD psd, MWCOORD x, MWCOORD y)
 	}
 }
 
+/*
+ * Draw a solid non-horizontal, non-vertical bresenham line as horizontal
+ * or vertical runs of pixels, clipping each run as a span unless the
+ * whole line is visible.  Draws the same points as a per-point line,
+ * which always includes the last point.
+ */
+static void
+drawlinespans(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
+	MWBOOL visible)
+{
+	int xdelta = x2 - x1;
+	int ydelta = y2 - y1;
+	int xinc = (x2 > x1)? 1 : -1;
+	int yinc = (y2 > y1)? 1 : -1;
+	int rem;
+	MWCOORD start;		/* first point of current run*/
+
+	if (xdelta < 0)
+		xdelta = -xdelta;
+	if (ydelta < 0)
+		ydelta = -ydelta;
+
+	if (xdelta >= ydelta) {
+		rem = xdelta / 2;
+		for (start = x1; x1 != x2; x1 += xinc) {
+			rem += ydelta;
+			if (rem >= xdelta) {
+				rem -= xdelta;
+				if (visible)
+					psd->DrawHorzLine(psd, MWMIN(start, x1), MWMAX(start, x1), y1, gr_foreground);
+				else GdClipDrawRow(psd, MWMIN(start, x1), MWMAX(start, x1), y1, gr_foreground);
+				y1 += yinc;
+				start = x1 + xinc;
+			}
+		}
+		if (visible)
+			psd->DrawHorzLine(psd, MWMIN(start, x2), MWMAX(start, x2), y1, gr_foreground);
+		else GdClipDrawRow(psd, MWMIN(start, x2), MWMAX(start, x2), y1, gr_foreground);
+	} else {
+		rem = ydelta / 2;
+		for (start = y1; y1 != y2; y1 += yinc) {
+			rem += xdelta;
+			if (rem >= ydelta) {
+				rem -= ydelta;
+				if (visible)
+					psd->DrawVertLine(psd, x1, MWMIN(start, y1), MWMAX(start, y1), gr_foreground);
+				else GdClipDrawCol(psd, x1, MWMIN(start, y1), MWMAX(start, y1), gr_foreground);
+				x1 += xinc;
+				start = y1 + yinc;
+			}
+		}
+		if (visible)
+			psd->DrawVertLine(psd, x1, MWMIN(start, y2), MWMAX(start, y2), gr_foreground);
+		else GdClipDrawCol(psd, x1, MWMIN(start, y2), MWMAX(start, y2), gr_foreground);
+	}
+}
+
 /**
  * Draw an arbitrary line using the current clipping region and foreground color
  * If bDrawLastPoint is FALSE, draw up to but not including point x2, y2.
@@ -257,11 +314,24 @@ GdLine(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2,
 		 GdFixCursor(psd);
 		 return;
 		 */
+		if (!gr_dashcount) {
+			drawlinespans(psd, x1, y1, x2, y2, TRUE);
+			GdFixCursor(psd);
+			return;
+		}
 		break;
 	case CLIP_INVISIBLE:
 		return;
 	}
 
+	/* Solid lines are drawn as runs of pixels, clipped as spans*/
+	if (!gr_dashcount) {
+		GdCheckCursor(psd, x1, y1, x2, y2);
+		drawlinespans(psd, x1, y1, x2, y2, FALSE);
+		GdFixCursor(psd);
+		return;
+	}
+
 	/* The line may be partially obscured. Do the draw line algorithm
 	 * checking each point against the clipping regions.
 	 */
@@ -368,14 +438,8 @@ drawrow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y)
 
 	/* If aren't trying to draw a dash, then head for the speed */
 	if (!gr_dashcount) {
-		while (x1 <= x2) {
-			if (GdClipPoint(psd, x1, y)) {
-				temp = MWMIN(clipmaxx, x2);
-				psd->DrawHorzLine(psd, x1, temp, y, gr_foreground);
-			} else
-				temp = MWMIN(clipmaxx, x2);
-			x1 = temp + 1;
-		}
+		if (x1 <= x2)
+			GdClipDrawRow(psd, x1, x2, y, gr_foreground);
 	} else {
 		unsigned bit = 0;
 		int p;				/* must use "int" to handle case when x2 < 0*/
@@ -415,14 +479,8 @@ drawcol(PSD psd, MWCOORD x,MWCOORD y1,MWCOORD y2)
 	GdCheckCursor(psd, x, y1, x, y2);
 
 	if (!gr_dashcount) {
-		while (y1 <= y2) {
-			if (GdClipPoint(psd, x, y1)) {
-				temp = MWMIN(clipmaxy, y2);
-				psd->DrawVertLine(psd, x, y1, temp, gr_foreground);
-			} else
-				temp = MWMIN(clipmaxy, y2);
-			y1 = temp + 1;
-		}
+		if (y1 <= y2)
+			GdClipDrawCol(psd, x, y1, y2, gr_foreground);
 	} else {
 		unsigned int p, bit = 0;
 
@@ -28,6 +28,9 @@ extern MWCOREFONT *user_builtin_fonts;
 
 static int utf8_to_utf16(const unsigned char *utf8, int cc, unsigned short *unicode16);
 int uc16_to_utf8(const unsigned short *us, int cc, unsigned char *s);
+#if MW_FEATURE_GLYPHCACHE
+static void gen_flushglyphs(PMWFONT pfont);
+#endif
 
 #if HAVE_FILEIO
 #include <stdio.h>
@@ -70,63 +73,184 @@ out:
 }
 #endif
 
+#if HAVE_FILEIO
+/* mwfonts.alias entry*/
+typedef struct mwfontalias {
+	struct mwfontalias *next;
+	char *	alias;			/* aliased font name*/
+	int	height;			/* aliased font height*/
+	char	name[1];		/* font name, alias string follows*/
+} MWFONTALIAS;
+
+static MWFONTALIAS *fontaliases;	/* alias table, read once on first use*/
+static int	fontaliases_loaded;
+
+/* read mwfonts.alias file into alias table*/
+static void
+mwfont_loadaliases(void)
+{
+    FILE *afp;
+    char *p, *size;
+    int h, n;
+    MWFONTALIAS *fa, **tail = &fontaliases;
+    char buf[80];
+
+    fontaliases_loaded = 1;
+    sprintf(buf, "%s/%s", MW_FONT_DIR, MWFONTSALIAS);
+    afp = fopen(buf, "r");
+    if (!afp)
+        return;
+    for (;;) {
+        if (!fgets(buf, sizeof(buf), afp))
+            break;
+        buf[strlen(buf) - 1] = '\0';
+
+        /* ignore blank and ! comments*/
+        if (buf[0] == '\0' || buf[0] == '!')
+            continue;
+
+        /* fontname is first space separated field*/
+        /* check for tab first as filename may have spaces*/
+        p = strchr(buf, '\t');
+        if (!p)
+            p = strchr(buf, ' ');
+        if (!p)
+            continue;
+        *p = '\0';
+
+        /* alias is second space separated field*/
+        do ++p; while (*p == ' ' || *p == '\t');
+
+        h = 13;
+        size = strchr(p, ',');
+        if (size) {
+            *size++ = '\0';
+            h = atoi(size);
+        }
+
+        n = strlen(buf) + 1;
+        if (!(fa = malloc(sizeof(MWFONTALIAS) + n + strlen(p))))
+            break;
+        strcpy(fa->name, buf);
+        fa->alias = &fa->name[n];
+        strcpy(fa->alias, p);
+        fa->height = h;
+        fa->next = NULL;
+        *tail = fa;
+        tail = &fa->next;
+    }
+    fclose(afp);
+}
+#endif
+
 /* check if passed fontname is aliased in mwfonts.alias file */
 char *
 mwfont_findalias(const char *fontname, int *height, int *width)
 {
 #if HAVE_FILEIO
-    FILE *afp;
-    char *p, *size;
-    int h = 13;
-    static char buf[80];
+    MWFONTALIAS *fa;
 
     if (!fontname)
         return NULL;
     if (*fontname == '/')       /* don't translate NX11 fonts with absolute path */
         return (char *)fontname;
-    sprintf(buf, "%s/%s", MW_FONT_DIR, MWFONTSALIAS);
-    afp = fopen(buf, "r");
-    if (afp) {
-        for (;;) {
-            if (!fgets(buf, sizeof(buf), afp))
-                break;
-            buf[strlen(buf) - 1] = '\0';
-
-            /* ignore blank and ! comments*/
-            if (buf[0] == '\0' || buf[0] == '!')
-                continue;
-
-            /* fontname is first space separated field*/
-            /* check for tab first as filename may have spaces*/
-            p = strchr(buf, '\t');
-            if (!p)
-                p = strchr(buf, ' ');
-            if (!p)
-                continue;
-            *p = '\0';
-
-            if (strcmp(fontname, buf) == 0) {
-                /* alias is second space separated field*/
-                do ++p; while (*p == ' ' || *p == '\t');
-
-                size = strchr(p, ',');
-                if (size) {
-                    *size++ = '\0';
-                    h = atoi(size);
-                }
-                if (!*height)
-                    *height = *width = h;
-                DPRINTF("mwfont_findalias: %s -> %s,%d\n", fontname, p, *height);
-                fclose(afp);
-                return p;
-            }
+    if (!fontaliases_loaded)
+        mwfont_loadaliases();
+    for (fa = fontaliases; fa; fa = fa->next) {
+        if (strcmp(fontname, fa->name) == 0) {
+            if (!*height)
+                *height = *width = fa->height;
+            DPRINTF("mwfont_findalias: %s -> %s,%d\n", fontname, fa->alias, *height);
+            return fa->alias;
         }
-        fclose(afp);
     }
 #endif
     return (char *)fontname;
 }
 
+#if MW_FEATURE_FONTCACHE
+/* loaded font shared by identical GdCreateFont requests*/
+typedef struct mwfontcache {
+	struct mwfontcache *next;
+	PMWFONT	pfont;			/* shared font*/
+	int	refcount;		/* # GdCreateFont returns not yet destroyed*/
+	MWCOORD	height;
+	MWCOORD	width;
+	int	fontattr;
+	int	fontclass;
+	char	name[1];		/* font name after alias lookup*/
+} MWFONTCACHE;
+
+static MWFONTCACHE *fontcache;
+
+/* return cached font matching request with reference added, or NULL*/
+static PMWFONT
+fontcache_find(const char *name, MWCOORD height, MWCOORD width, int fontattr, int fontclass)
+{
+	MWFONTCACHE *fc;
+
+	if (!name)
+		return NULL;
+	for (fc = fontcache; fc; fc = fc->next) {
+		if (fc->height == height && fc->width == width && fc->fontattr == fontattr &&
+		    fc->fontclass == fontclass && strcmp(fc->name, name) == 0) {
+			fc->refcount++;
+			DPRINTF("fontcache_find: %s,%d refcount %d\n", name, height, fc->refcount);
+			return fc->pfont;
+		}
+	}
+	return NULL;
+}
+
+/* add newly loaded font to cache, returns pfont*/
+static PMWFONT
+fontcache_add(PMWFONT pfont, const char *name, MWCOORD height, MWCOORD width,
+	int fontattr, int fontclass)
+{
+	MWFONTCACHE *fc;
+	PMWFONTPROCS fp = pfont->fontprocs;
+
+	/* only share fonts that can't be changed per instance*/
+	if (!name || !fp->DestroyFont || fp->SetFontSize || fp->SetFontRotation || fp->SetFontAttr)
+		return pfont;
+
+	if (!(fc = malloc(sizeof(MWFONTCACHE) + strlen(name))))
+		return pfont;
+	fc->pfont = pfont;
+	fc->refcount = 1;
+	fc->height = height;
+	fc->width = width;
+	fc->fontattr = fontattr;
+	fc->fontclass = fontclass;
+	strcpy(fc->name, name);
+	fc->next = fontcache;
+	fontcache = fc;
+	return pfont;
+}
+
+/* drop a reference to font, returns TRUE if a cached font is still in use*/
+static MWBOOL
+fontcache_release(PMWFONT pfont)
+{
+	MWFONTCACHE *fc, **prev;
+
+	for (prev = &fontcache; (fc = *prev) != NULL; prev = &fc->next) {
+		if (fc->pfont == pfont) {
+			if (--fc->refcount > 0)
+				return TRUE;
+			*prev = fc->next;
+			free(fc);
+			return FALSE;
+		}
+	}
+	return FALSE;
+}
+
+#define CACHEFONT(pfont)	fontcache_add(pfont, fontname, height, width, fontattr, fontclass)
+#else
+#define CACHEFONT(pfont)	(pfont)
+#endif /* MW_FEATURE_FONTCACHE*/
+
 /**
  * Select a font, based on various parameters.
  * If plogfont is specified, name and height parms are ignored
@@ -247,6 +371,12 @@ GdCreateFont(PSD psd, const char *name, MWCOORD height, MWCOORD width, const PMW
 		upf++;
 	}
 
+#if MW_FEATURE_FONTCACHE
+	/* share already loaded font if identical request*/
+	if ((pfont = fontcache_find(fontname, height, width, fontattr, fontclass)) != NULL)
+		return pfont;
+#endif
+
 	/* try to load font (regardless of height) using other renderers*/
 
 #if HAVE_FNT_SUPPORT
@@ -254,7 +384,7 @@ GdCreateFont(PSD psd, const char *name, MWCOORD height, MWCOORD width, const PMW
 		pfont = (PMWFONT)fnt_createfont(fontname, height, width, fontattr);
 		if (pfont) {
 			DPRINTF("fnt_createfont: using font %s\n", fontname);
-			return pfont;
+			return CACHEFONT(pfont);
 		}
 		if (fontclass != MWLF_CLASS_ANY)
 			EPRINTF("fnt_createfont: %s,%d not found\n", fontname, height);
@@ -266,7 +396,7 @@ GdCreateFont(PSD psd, const char *name, MWCOORD height, MWCOORD width, const PMW
 		pfont = (PMWFONT)pcf_createfont(fontname, height, width, fontattr);
 		if (pfont) {
 			DPRINTF("pcf_createfont: using font %s\n", fontname);
-			return pfont;
+			return CACHEFONT(pfont);
 		}
 		if (fontclass != MWLF_CLASS_ANY)
 			EPRINTF("pcf_createfont: %s,%d not found\n", fontname, height);
@@ -305,7 +435,7 @@ GdCreateFont(PSD psd, const char *name, MWCOORD height, MWCOORD width, const PMW
 	if (fontclass == MWLF_CLASS_ANY || fontclass == MWLF_CLASS_HZK) {
 		pfont = (PMWFONT)hzk_createfont(fontname, height, width, fontattr);
 		if(pfont)		
-			return pfont;
+			return CACHEFONT(pfont);
 		if (fontclass != MWLF_CLASS_ANY)
 			EPRINTF("hzk_createfont: %s,%d not found\n", fontname, height);
 	}
@@ -315,7 +445,7 @@ GdCreateFont(PSD psd, const char *name, MWCOORD height, MWCOORD width, const PMW
 	if (fontclass == MWLF_CLASS_ANY || fontclass == MWLF_CLASS_HZK) {
 		pfont = (PMWFONT)hbf_createfont(fontname, height, width, fontattr);
 		if(pfont)
-			return pfont;
+			return CACHEFONT(pfont);
 		if (fontclass != MWLF_CLASS_ANY)
 			EPRINTF("hbf_createfont: %s,%d not found\n", fontname, height);
 	}
@@ -326,7 +456,7 @@ GdCreateFont(PSD psd, const char *name, MWCOORD height, MWCOORD width, const PMW
 		pfont = (PMWFONT)eucjp_createfont(fontname, height, width, fontattr);
 		if (pfont) {
 			DPRINTF("eujcp_createfont: using font %s\n", fontname);
-			return pfont;
+			return CACHEFONT(pfont);
 		}
 		if (fontclass != MWLF_CLASS_ANY)
 			EPRINTF("eucjp_createfont: %s,%d not found\n", fontname, height);
@@ -451,6 +581,13 @@ GdSetFontAttr(PMWFONT pfont, int setflags, int clrflags)
 void
 GdDestroyFont(PMWFONT pfont)
 {
+#if MW_FEATURE_FONTCACHE
+	if (fontcache_release(pfont))
+		return;			/* still used by other GdCreateFont callers*/
+#endif
+#if MW_FEATURE_GLYPHCACHE
+	gen_flushglyphs(pfont);
+#endif
 	if (pfont->fontprocs->DestroyFont)
 		pfont->fontprocs->DestroyFont(pfont);
 }
@@ -560,6 +697,253 @@ GdText(PSD psd, PMWFONT pfont, MWCOORD x, MWCOORD y, const void *str, int cc,MWT
 		FREEA(buf);
 }
 
+#if MW_FEATURE_GLYPHCACHE
+/*
+ * Glyph cache for COREFONT type fonts.  Glyph bitmaps and metrics are
+ * copied on first use, since some GetTextBits routines return a static
+ * buffer, into a direct mapped table keyed by font, size, attributes and
+ * character.  gen_drawtext uses it to build the whole string run as
+ * a single bitmap, which is then drawn with one blit.
+ */
+#define GLYPHCACHE_SIZE	256		/* # cached glyphs, must be power of 2*/
+
+typedef struct {
+	PMWFONT		pfont;			/* font glyph is from, NULL if unused*/
+	int			ch;				/* character*/
+	MWCOORD		fontsize;		/* font size and attributes when cached*/
+	int			fontattr;
+	MWTEXTFLAGS	dbcs;			/* DBCS flags used to select font*/
+	MWCOORD		width;			/* glyph metrics*/
+	MWCOORD		height;
+	MWCOORD		base;
+	int			size;			/* allocated size of bits in words*/
+	MWIMAGEBITS *bits;			/* copy of glyph bitmap*/
+} MWGLYPH;
+
+static MWGLYPH		glyphcache[GLYPHCACHE_SIZE];
+static unsigned long glyphcache_hits;
+static unsigned long glyphcache_misses;
+static MWIMAGEBITS *runbits;	/* string run bitmap*/
+static int			runsize;	/* allocated size of runbits in words*/
+
+/* return cached glyph, reading it from the font if not present, NULL on no memory*/
+static MWGLYPH *
+gen_getglyph(PMWFONT pfont, int ch, MWTEXTFLAGS flags)
+{
+	MWGLYPH *	gp;
+	const MWIMAGEBITS *bitmap;
+	MWCOORD		width, height, base;
+	int			n;
+
+	gp = &glyphcache[(((size_t)pfont >> 4) + ch * 31) & (GLYPHCACHE_SIZE - 1)];
+	flags &= MWTF_DBCSMASK;
+	if (gp->pfont == pfont && gp->ch == ch && gp->fontsize == pfont->fontsize &&
+	    gp->fontattr == pfont->fontattr && gp->dbcs == flags) {
+		++glyphcache_hits;
+		return gp;
+	}
+	++glyphcache_misses;
+
+#if MW_FEATURE_INTL
+	if (flags)
+		dbcs_gettextbits(pfont, ch, flags, &bitmap, &width, &height, &base);
+	else
+#endif
+		pfont->fontprocs->GetTextBits(pfont, ch, &bitmap, &width, &height, &base);
+
+	n = MWIMAGE_WORDS(width) * height;
+	if (n > gp->size) {
+		MWIMAGEBITS *bits = realloc(gp->bits, n * sizeof(MWIMAGEBITS));
+		if (!bits) {
+			gp->pfont = NULL;
+			return NULL;
+		}
+		gp->bits = bits;
+		gp->size = n;
+	}
+	if (n > 0)
+		memcpy(gp->bits, bitmap, n * sizeof(MWIMAGEBITS));
+
+	gp->pfont = pfont;
+	gp->ch = ch;
+	gp->fontsize = pfont->fontsize;
+	gp->fontattr = pfont->fontattr;
+	gp->dbcs = flags;
+	gp->width = width;
+	gp->height = height;
+	gp->base = base;
+	return gp;
+}
+
+/* remove all glyphs for a font from the glyph cache*/
+static void
+gen_flushglyphs(PMWFONT pfont)
+{
+	int i;
+
+	for (i = 0; i < GLYPHCACHE_SIZE; i++)
+		if (glyphcache[i].pfont == pfont)
+			glyphcache[i].pfont = NULL;
+}
+
+/* return glyph cache hit and miss counts*/
+void
+GdGetGlyphCacheStats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = glyphcache_hits;
+	*misses = glyphcache_misses;
+}
+
+/* OR glyph bitmap into run bitmap at pixel offset xoff*/
+static void
+gen_blitglyph(MWIMAGEBITS *dst, int dstwords, MWGLYPH *gp, int xoff)
+{
+	int		words = MWIMAGE_WORDS(gp->width);
+	int		shift = xoff & 15;
+	MWIMAGEBITS lastmask = (gp->width & 15)? (MWIMAGEBITS)(0xffff << (16 - (gp->width & 15))): 0xffff;
+	const MWIMAGEBITS *src = gp->bits;
+	int		row, i;
+
+	dst += xoff >> 4;
+	for (row = 0; row < gp->height; row++) {
+		for (i = 0; i < words; i++) {
+			MWIMAGEBITS bits = *src++;
+
+			if (i == words - 1)
+				bits &= lastmask;	/* glyph padding bits may not be clear*/
+			dst[i] |= bits >> shift;
+			if (shift && (bits << (16 - shift)) & 0xffff)
+				dst[i+1] |= (MWIMAGEBITS)(bits << (16 - shift));
+		}
+		dst += dstwords;
+	}
+}
+
+/*
+ * Draw string using glyph cache, building all glyphs into a single
+ * bitmap and drawing it in one pass.  Returns FALSE without drawing
+ * if glyph heights differ or memory is low, for gen_drawtext fallback.
+ */
+static MWBOOL
+gen_drawtextrun(PMWFONT pfont, PSD psd, MWCOORD x, MWCOORD y,
+	const void *text, int cc, MWTEXTFLAGS flags)
+{
+	const unsigned char *str = text;
+	const unsigned short *istr = text;
+	MWGLYPH *	gp;
+	MWCOORD		width = 0;		/* width of text area */
+	MWCOORD 	height = 0;		/* height of text area */
+	MWCOORD		base = 0;		/* baseline of text*/
+	int			i, n, ch, words;
+	int			uc16 = (flags & MWTF_DBCSMASK) || pfont->fontprocs->encoding == MWTF_UC16;
+	MWBOOL		bgstate = gr_usebg;
+	int			clip;
+	MWBLITFUNC convblit;
+	MWBLITPARMS parms;
+
+	/* first pass: get glyphs and size text area, stop past right edge of screen*/
+	for (n = 0; n < cc && x + width < psd->xvirtres; n++) {
+		ch = uc16? istr[n]: str[n];
+		if ((gp = gen_getglyph(pfont, ch, flags)) == NULL)
+			return FALSE;
+		if (gp->width == 0 || gp->height == 0)
+			continue;
+		if (height && gp->height != height)
+			return FALSE;			/* mixed height DBCS, draw per character*/
+		height = gp->height;
+		if (gp->base > base)
+			base = gp->base;
+		width += gp->width;
+	}
+
+	/* return if nothing to draw*/
+	if (width == 0 || height == 0)
+		return TRUE;
+
+	words = MWIMAGE_WORDS(width);
+	if (words * height > runsize) {
+		MWIMAGEBITS *bits = realloc(runbits, words * height * sizeof(MWIMAGEBITS));
+		if (!bits)
+			return FALSE;
+		runbits = bits;
+		runsize = words * height;
+	}
+	memset(runbits, 0, words * height * sizeof(MWIMAGEBITS));
+
+	/* second pass: build run bitmap, glyphs may have been replaced by collisions*/
+	for (i = 0, width = 0; i < n; i++) {
+		ch = uc16? istr[i]: str[i];
+		if ((gp = gen_getglyph(pfont, ch, flags)) == NULL)
+			return FALSE;
+		if (gp->width == 0 || gp->height == 0)
+			continue;
+		gen_blitglyph(runbits, words, gp, width);
+		width += gp->width;
+	}
+
+	if (flags & MWTF_BASELINE)
+		y -= base;
+	else if (flags & MWTF_BOTTOM)
+		y -= (height - 1);
+
+	convblit = GdFindConvBlit(psd, MWIF_MONOWORDMSB, MWROP_COPY);
+
+	/* pre-clip entire text area for speed*/
+	switch (clip = GdClipArea(psd, x, y, x + width - 1, y + height - 1)) {
+	case CLIP_VISIBLE:
+		/* fast clear background once if drawing point by point*/
+		if (!convblit && gr_usebg) {
+			psd->FillRect(psd, x, y, x + width - 1, y + height - 1, gr_background);
+			gr_usebg = FALSE;
+		}
+		break;
+
+	case CLIP_INVISIBLE:
+		return TRUE;
+	}
+
+	/* use fast blit for text draw, fallback draw point-by-point*/
+	if (convblit) {
+		parms.op = MWROP_COPY;					/* copy to dst, 1=fg (0=bg if usebg)*/
+		parms.data_format = MWIF_MONOWORDMSB;	/* data is 1bpp words, msb first*/
+		parms.fg_colorval = gr_foreground_rgb;
+		parms.bg_colorval = gr_background_rgb;
+		parms.fg_pixelval = gr_foreground;		/* for palette mask convblit*/
+		parms.bg_pixelval = gr_background;
+		parms.usebg = gr_usebg;
+		parms.srcx = 0;
+		parms.srcy = 0;
+		parms.dst_pitch = psd->pitch;			/* usually set in GdConversionBlit*/
+		parms.data_out = psd->addr;
+		parms.srcpsd = NULL;
+		parms.dstx = x;
+		parms.dsty = y;
+		parms.height = height;
+		parms.width = width;
+		parms.src_pitch = words * sizeof(MWIMAGEBITS);
+		parms.data = (char *)runbits;
+		/* skip clipping checks if fully visible*/
+		if (clip == CLIP_VISIBLE)
+			convblit(psd, &parms);
+		else
+			GdConversionBlit(psd, &parms);
+	}
+#if !SWIEROS
+	else
+		GdBitmapByPoint(psd, x, y, width, height, runbits, clip);
+#endif
+
+	if (pfont->fontattr & MWTF_UNDERLINE)
+		GdLine(psd, x, y + base, x + width, y + base, FALSE);
+
+	/* restore background draw state*/
+	gr_usebg = bgstate;
+
+	GdFixCursor(psd);
+	return TRUE;
+}
+#endif /* MW_FEATURE_GLYPHCACHE*/
+
 /*
  * Draw ASCII or MWTF_UC16 text using COREFONT type font (buitin, PCF, FNT)
  */
@@ -579,6 +963,12 @@ gen_drawtext(PMWFONT pfont, PSD psd, MWCOORD x, MWCOORD y,
 	MWBLITFUNC convblit;
 	MWBLITPARMS parms;
 
+#if MW_FEATURE_GLYPHCACHE
+	/* draw entire string in one pass if possible*/
+	if (gen_drawtextrun(pfont, psd, x, y, text, cc, flags))
+		return;
+#endif
+
 	/* fill in unchanging convblit parms*/
 	parms.op = MWROP_COPY;					/* copy to dst, 1=fg (0=bg if usebg)*/
 	parms.data_format = MWIF_MONOWORDMSB;	/* data is 1bpp words, msb first*/
@@ -10,6 +10,8 @@
 /* font engine entry points*/
 #if HAVE_FNT_SUPPORT
 PMWFONT fnt_createfont(const char *name, MWCOORD height, MWCOORD width, int attr);
+PMWFONT fnt_openfont(const char *path);
+int	fnt_savefont(PMWCFONT pf, const char *path, const char *copyright);
 #endif
 
 #if HAVE_T1LIB_SUPPORT
@@ -64,6 +64,52 @@ static void copy_row3(unsigned char *src, int src_w, unsigned char *dst,
 	}
 }
 
+/* stretch parameters shared by row bands*/
+typedef struct {
+	PMWIMAGEHDR	src;
+	MWCLIPRECT *srcrect;
+	PMWIMAGEHDR	dst;
+	MWCLIPRECT *dstrect;
+	int			inc;		/* source rows per dest row, 16.16 fixed point*/
+} STRETCHARGS;
+
+/* stretch dest rows y to y+height-1 of dstrect*/
+static void
+stretch_rows(void *arg, int band, int y, int height)
+{
+	STRETCHARGS *sa = arg;
+	PMWIMAGEHDR src = sa->src;
+	PMWIMAGEHDR dst = sa->dst;
+	MWCLIPRECT *srcrect = sa->srcrect;
+	MWCLIPRECT *dstrect = sa->dstrect;
+	int bytesperpixel = (dst->bpp + 7) / 8;
+	int dst_row, dst_maxrow;
+	MWUCHAR *srcp;
+	MWUCHAR *dstp;
+
+	for (dst_row = y, dst_maxrow = y+height; dst_row<dst_maxrow; ++dst_row) {
+		int src_row = srcrect->y + (int)(((unsigned long)dst_row * sa->inc) >> 16);
+
+		dstp = (MWUCHAR *)dst->imagebits + ((dstrect->y+dst_row)*dst->pitch) + (dstrect->x*bytesperpixel);
+		srcp = (MWUCHAR *)src->imagebits + (src_row*src->pitch) + (srcrect->x*bytesperpixel);
+
+		switch (bytesperpixel) {
+		case 1:
+			copy_row1(srcp, srcrect->width, dstp, dstrect->width);
+			break;
+		case 2:
+			copy_row2((unsigned short *)srcp, srcrect->width, (unsigned short *)dstp, dstrect->width);
+			break;
+		case 3:
+			copy_row3(srcp, srcrect->width, dstp, dstrect->width);
+			break;
+		case 4:
+			copy_row4((uint32_t *)srcp, srcrect->width, (uint32_t *)dstp, dstrect->width);
+			break;
+		}
+	}
+}
+
 /**
  * Perform a stretch blit between two image structs of the same format.
  *
@@ -75,11 +121,7 @@ static void copy_row3(unsigned char *src, int src_w, unsigned char *dst,
 void
 GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT *dstrect)
 {
-	int pos, inc;
-	int dst_maxrow;
-	int src_row, dst_row;
-	MWUCHAR *srcp = 0;
-	MWUCHAR *dstp;
+	STRETCHARGS args;
 	MWCLIPRECT full_src;
 	MWCLIPRECT full_dst;
 	int srcbytesperpixel = (src->bpp + 7) / 8;
@@ -124,36 +166,13 @@ GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT
 	}
 
 	/* Set up the data... */
-	pos = 0x10000;
-	inc = (srcrect->height << 16) / dstrect->height;
-	src_row = srcrect->y;
-	dst_row = dstrect->y;
-
-	/* Perform the stretch blit */
-	for ( dst_maxrow = dst_row+dstrect->height; dst_row<dst_maxrow; ++dst_row ) {
-		dstp = (MWUCHAR *)dst->imagebits + (dst_row*dst->pitch) + (dstrect->x*bytesperpixel);
-		while ( pos >= 0x10000L ) {
-			srcp = (MWUCHAR *)src->imagebits + (src_row*src->pitch) + (srcrect->x*bytesperpixel);
-			++src_row;
-			pos -= 0x10000L;
-		}
-
-		switch (bytesperpixel) {
-		case 1:
-			copy_row1(srcp, srcrect->width, dstp, dstrect->width);
-			break;
-		case 2:
-			copy_row2((unsigned short *)srcp, srcrect->width, (unsigned short *)dstp, dstrect->width);
-			break;
-		case 3:
-			copy_row3(srcp, srcrect->width, dstp, dstrect->width);
-			break;
-		case 4:
-			copy_row4((uint32_t *)srcp, srcrect->width, (uint32_t *)dstp, dstrect->width);
-			break;
-		}
+	args.src = src;
+	args.srcrect = srcrect;
+	args.dst = dst;
+	args.dstrect = dstrect;
+	args.inc = (srcrect->height << 16) / dstrect->height;
 
-		pos += inc;
-	}
+	/* Perform the stretch blit, in parallel row bands if large*/
+	GdTileRows(dstrect->height, (long)dstrect->width * dstrect->height, stretch_rows, &args);
 }
 #endif /* MW_FEATURE_IMAGES*/
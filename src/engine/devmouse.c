@@ -377,15 +377,9 @@ GdSetCursor(PMWCURSOR pcursor)
 }
 
 
-/**
- * Draw the mouse pointer.  Save the screen contents underneath
- * before drawing. Returns previous cursor state.
- *
- * @param psd Drawing surface.
- * @return 1 iff the cursor was visible, else <= 0
- */
-int
-GdShowCursor(PSD psd)
+/* save screen contents under cursor and draw it*/
+static void
+drawcursor(PSD psd)
 {
 	MWCOORD 		x;
 	MWCOORD 		y;
@@ -396,10 +390,7 @@ GdShowCursor(PSD psd)
 	MWPIXELVALHW 	oldcolor;
 	MWPIXELVALHW 	newcolor;
 	int 		oldmode;
-	int		prevcursor = curvisible;
 
-	if(++curvisible != 1)
-		return prevcursor;
 	oldmode = gr_mode;
 	gr_mode = MWROP_COPY;
 
@@ -442,25 +433,16 @@ GdShowCursor(PSD psd)
 	}
 
 	gr_mode = oldmode;
-	return prevcursor;
 }
 
-/**
- * Restore the screen overwritten by the cursor.
- *
- * @param psd Drawing surface.
- * @return 1 iff the cursor was visible, else <= 0
- */
-int
-GdHideCursor(PSD psd)
+/* restore screen contents saved by drawcursor*/
+static void
+restorecursor(PSD psd)
 {
 	MWPIXELVALHW *	saveptr;
 	MWCOORD 		x, y;
 	int 		oldmode;
-	int		prevcursor = curvisible;
 
-	if(curvisible-- <= 0)
-		return prevcursor;
 	oldmode = gr_mode;
 	gr_mode = MWROP_COPY;
 
@@ -474,9 +456,177 @@ GdHideCursor(PSD psd)
 		}
 	}
  	gr_mode = oldmode;
+}
+
+#if MW_FEATURE_CURSOROVERLAY
+/*
+ * Clip a cursor box to the screen and convert it to the physical
+ * (unrotated) coordinates used by Update and the damage region.
+ * Returns FALSE if the box is entirely offscreen.
+ */
+static MWBOOL
+cursorphysrect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2, MWRECT *prc)
+{
+	if (x1 < 0)
+		x1 = 0;
+	if (y1 < 0)
+		y1 = 0;
+	if (x2 >= psd->xvirtres)
+		x2 = psd->xvirtres - 1;
+	if (y2 >= psd->yvirtres)
+		y2 = psd->yvirtres - 1;
+	if (x1 > x2 || y1 > y2)
+		return FALSE;
+
+	switch (psd->portrait) {
+	case MWPORTRAIT_LEFT:
+		prc->left = y1;
+		prc->right = y2 + 1;
+		prc->top = psd->xvirtres - x2 - 1;
+		prc->bottom = psd->xvirtres - x1;
+		break;
+	case MWPORTRAIT_RIGHT:
+		prc->left = psd->yvirtres - y2 - 1;
+		prc->right = psd->yvirtres - y1;
+		prc->top = x1;
+		prc->bottom = x2 + 1;
+		break;
+	case MWPORTRAIT_DOWN:
+		prc->left = psd->xvirtres - x2 - 1;
+		prc->right = psd->xvirtres - x1;
+		prc->top = psd->yvirtres - y2 - 1;
+		prc->bottom = psd->yvirtres - y1;
+		break;
+	default:
+		prc->left = x1;
+		prc->right = x2 + 1;
+		prc->top = y1;
+		prc->bottom = y2 + 1;
+		break;
+	}
+	return TRUE;
+}
+
+/* mark the onscreen part of a cursor box for update*/
+static void
+cursorupdate(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2)
+{
+	MWRECT rc;
+
+	if (psd->Update && cursorphysrect(psd, x1, y1, x2, y2, &rc))
+		psd->Update(psd, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top);
+}
+#endif /* MW_FEATURE_CURSOROVERLAY*/
+
+/**
+ * Draw the mouse pointer.  Save the screen contents underneath
+ * before drawing. Returns previous cursor state.
+ *
+ * @param psd Drawing surface.
+ * @return 1 iff the cursor was visible, else <= 0
+ */
+int
+GdShowCursor(PSD psd)
+{
+	int		prevcursor = curvisible;
+
+	if(++curvisible != 1)
+		return prevcursor;
+
+#if MW_FEATURE_CURSOROVERLAY
+	/* composited at flush, just mark area for update*/
+	if (psd->flags & PSF_CURSOROVERLAY) {
+		cursavx = curminx;
+		cursavy = curminy;
+		cursavx2 = curmaxx;
+		cursavy2 = curmaxy;
+		cursorupdate(psd, curminx, curminy, curmaxx, curmaxy);
+		return prevcursor;
+	}
+#endif
+
+	drawcursor(psd);
 	return prevcursor;
 }
 
+/**
+ * Restore the screen overwritten by the cursor.
+ *
+ * @param psd Drawing surface.
+ * @return 1 iff the cursor was visible, else <= 0
+ */
+int
+GdHideCursor(PSD psd)
+{
+	int		prevcursor = curvisible;
+
+	if(curvisible-- <= 0)
+		return prevcursor;
+
+#if MW_FEATURE_CURSOROVERLAY
+	/* screen under cursor was never overwritten, just mark area for update*/
+	if (psd->flags & PSF_CURSOROVERLAY) {
+		cursorupdate(psd, cursavx, cursavy, cursavx2, cursavy2);
+		return prevcursor;
+	}
+#endif
+
+	restorecursor(psd);
+	return prevcursor;
+}
+
+#if MW_FEATURE_CURSOROVERLAY
+/**
+ * Composite the cursor into the screen framebuffer for a driver flush.
+ * Called by screen drivers with PSF_CURSOROVERLAY set before copying the
+ * area to the display, followed by GdEraseCursorOverlay after.
+ * The flushed area is in physical (unrotated) screen coordinates.
+ *
+ * @param psd Screen device.
+ * @param x Left edge of area being flushed.
+ * @param y Top edge of area being flushed.
+ * @param width Width of area being flushed.
+ * @param height Height of area being flushed.
+ * @return TRUE if cursor was drawn and must be erased.
+ */
+MWBOOL
+GdDrawCursorOverlay(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	void (*update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+	MWRECT rc;
+
+	if (!(psd->flags & PSF_CURSOROVERLAY) || curvisible <= 0)
+		return FALSE;
+	if (!cursorphysrect(psd, curminx, curminy, curmaxx, curmaxy, &rc))
+		return FALSE;
+	if (x >= rc.right || x + width <= rc.left || y >= rc.bottom || y + height <= rc.top)
+		return FALSE;
+
+	/* don't report the cursor pixels as new damage*/
+	update = psd->Update;
+	psd->Update = NULL;
+	drawcursor(psd);
+	psd->Update = update;
+	return TRUE;
+}
+
+/**
+ * Remove the cursor drawn by GdDrawCursorOverlay.
+ *
+ * @param psd Screen device.
+ */
+void
+GdEraseCursorOverlay(PSD psd)
+{
+	void (*update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+
+	update = psd->Update;
+	psd->Update = NULL;
+	restorecursor(psd);
+	psd->Update = update;
+}
+#endif /* MW_FEATURE_CURSOROVERLAY*/
+
 /**
  * Check to see if the mouse pointer is about to be overwritten.
  * If so, then remove the cursor so that the graphics operation
@@ -495,7 +645,7 @@ GdCheckCursor(PSD psd,MWCOORD x1,MWCOORD y1,MWCOORD x2,MWCOORD y2)
 {
 	MWCOORD temp;
 
-	if (curvisible <= 0 || (psd->flags & PSF_SCREEN) == 0)
+	if (curvisible <= 0 || (psd->flags & (PSF_SCREEN|PSF_CURSOROVERLAY)) != PSF_SCREEN)
 		return;
 
 	if (x1 > x2) {
@@ -521,7 +671,7 @@ GdCheckCursor(PSD psd,MWCOORD x1,MWCOORD y1,MWCOORD x2,MWCOORD y2)
 void
 GdEraseCursor(PSD psd)
 {
-	if (curvisible <= 0 || (psd->flags & PSF_SCREEN) == 0)
+	if (curvisible <= 0 || (psd->flags & (PSF_SCREEN|PSF_CURSOROVERLAY)) != PSF_SCREEN)
 		return;
 
 	GdHideCursor(psd);
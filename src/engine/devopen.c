@@ -49,6 +49,34 @@ MWPOINT    gr_ts_offset;
 MWCOORD    nxres;           /* requested server x resolution*/
 MWCOORD    nyres;           /* requested server y resolution*/
 
+#if MW_FEATURE_PALETTE
+/*
+ * Recently found system palette colors, direct mapped by color.
+ * Flushed when the system palette changes.
+ */
+#define FINDCACHESIZE	64
+#define FINDCACHEHASH(c) ((((c) >> 18) ^ ((c) >> 10) ^ ((c) >> 2)) & (FINDCACHESIZE-1))
+static struct {
+	MWCOLORVAL	color;		/* 0x00BBGGRR color*/
+	int			size;		/* palette size searched, 0 if unused*/
+	MWPIXELVAL	pixel;		/* nearest palette index*/
+} findcache[FINDCACHESIZE];
+
+static unsigned char *invcmap;	/* RGB555 to 8bpp pixel inverse colormap*/
+static int	invcmap_pixtype = -1;	/* pixtype invcmap built for, -1 if invalid*/
+static int	invcmap_ncolors;		/* # colors invcmap built for*/
+
+static void
+flush_palette_caches(void)
+{
+	int	i;
+
+	for (i=0; i<FINDCACHESIZE; ++i)
+		findcache[i].size = 0;
+	invcmap_pixtype = -1;
+}
+#endif /* MW_FEATURE_PALETTE*/
+
 /**
  * Open low level graphics driver and optionally clear screen.
  *
@@ -249,6 +277,9 @@ GdSetPalette(PSD psd, int first, int count, MWPALENTRY *palette)
 		/* copy palette for GdFind*Color*/
 		for(i=0; i<count; ++i)
 			gr_palette[i+first] = palette[i];
+#if MW_FEATURE_PALETTE
+		flush_palette_caches();
+#endif
 	}
 }
 
@@ -282,7 +313,8 @@ GdGetPalette(PSD psd, int first, int count, MWPALENTRY *palette)
 
 /**
  * Search a palette to find the nearest color requested.
- * Uses a weighted squares comparison.
+ * Uses a weighted squares comparison.  Searches of the system
+ * palette are cached until the palette is changed.
  *
  * @param pal Palette to search.
  * @param size Size of palette (number of entries).
@@ -297,11 +329,20 @@ GdFindNearestColor(MWPALENTRY *pal, int size, MWCOLORVAL cr)
 	int32_t		diff = 0x7fffffffL;
 	int32_t		sq;
 	int		best = 0;
+	int		h = 0;
+
+	/* check recently found system palette colors*/
+	if (pal == gr_palette) {
+		cr &= 0x00ffffff;
+		h = FINDCACHEHASH(cr);
+		if (findcache[h].size == size && findcache[h].color == cr)
+			return findcache[h].pixel;
+	}
 
 	r = REDVALUE(cr);
 	g = GREENVALUE(cr);
 	b = BLUEVALUE(cr);
-	for(rgb=pal; diff && rgb < &pal[size]; ++rgb) {
+	for(rgb=pal; rgb < &pal[size]; ++rgb) {
 		R = rgb->r - r;
 		G = rgb->g - g;
 		B = rgb->b - b;
@@ -318,11 +359,51 @@ GdFindNearestColor(MWPALENTRY *pal, int size, MWCOLORVAL cr)
 		if(sq < diff) {
 			best = rgb - pal;
 			if((diff = sq) == 0)
-				return best;
+				break;		/* exact match*/
 		}
 	}
+
+	if (pal == gr_palette) {
+		findcache[h].color = cr;
+		findcache[h].size = size;
+		findcache[h].pixel = best;
+	}
 	return best;
 }
+
+/**
+ * Return the inverse colormap for an 8bpp or smaller drawing surface,
+ * which maps 15-bit RGB555 colors to the nearest pixel value, indexed
+ * by RGB2PIXEL555(r,g,b).  The table is built on first use and rebuilt
+ * after the system palette changes.
+ *
+ * @param psd Drawing surface.
+ * @return Inverse colormap, or NULL if not an 8bpp or smaller surface.
+ */
+unsigned char *
+GdGetInverseColormap(PSD psd)
+{
+	int	r, g, b;
+	unsigned char *p;
+
+	if (psd->bpp > 8)
+		return NULL;
+	if (invcmap && invcmap_pixtype == psd->pixtype && invcmap_ncolors == psd->ncolors)
+		return invcmap;
+
+	if (!invcmap && !(invcmap = (unsigned char *)malloc(32*32*32)))
+		return NULL;
+
+	/* find nearest pixel for the center of each RGB555 color cell*/
+	p = invcmap;
+	for(r=0; r<32; ++r)
+		for(g=0; g<32; ++g)
+			for(b=0; b<32; ++b)
+				*p++ = GdFindColor(psd, MWRGB((r<<3)|4, (g<<3)|4, (b<<3)|4));
+	invcmap_pixtype = psd->pixtype;
+	invcmap_ncolors = psd->ncolors;
+	return invcmap;
+}
 #endif /* MW_FEATURE_PALETTE*/
 
 /**
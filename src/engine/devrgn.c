@@ -105,9 +105,8 @@ typedef void (*REGION_NonOverlapBandFunctionPtr) (MWCLIPREGION * pReg, MWRECT *
  */
 #define MEMCHECK(reg, rect, firstrect){\
         if ((reg)->numRects >= ((reg)->size - 1)){\
-          (firstrect) = REALLOC(\
-           (firstrect), ((sizeof(MWRECT)) * ((reg)->size)), \
-           (2 * (sizeof(MWRECT)) * ((reg)->size)));\
+          (firstrect) = GdReallocRegionRects(\
+           (firstrect), (reg)->size, 2 * (reg)->size);\
           if ((firstrect) == 0)\
             return;\
           (reg)->size *= 2;\
@@ -308,6 +307,139 @@ GdEmptyRegion(MWCLIPREGION *rgn)
 	return rgn->numRects == 0;
 }
 
+/*
+ * Region headers and rectangle arrays are allocated from free lists, with
+ * rectangle arrays in power of two size classes up to POOLMAXRECTS, so that
+ * the many temporary regions created for clipping and exposure don't each
+ * call malloc.  At most MW_REGIONPOOL_MAX free items are kept per list,
+ * fewer for arrays over 16 rectangles, bounding pool memory to about
+ * 1500 rectangles with the default.
+ */
+#define POOLCLASSES		9					/* size classes 1, 2, 4 ... 256 rects*/
+#define POOLMAXRECTS	(1 << (POOLCLASSES - 1))
+#define POOLMAX(c)		((c) <= 4? MW_REGIONPOOL_MAX: MW_REGIONPOOL_MAX >> ((c) - 4))
+
+#if MW_FEATURE_REGIONPOOL
+static void *rectpool[POOLCLASSES];		/* free rect arrays, linked through first rect*/
+static int rectpoolcount[POOLCLASSES];
+static MWCLIPREGION *regionpool;		/* free region headers, linked through rects*/
+static int regionpoolcount;
+#endif
+static unsigned long region_allocs;		/* region headers and rect arrays allocated*/
+static unsigned long region_mallocs;	/* allocations not satisfied from pool*/
+
+#if MW_FEATURE_REGIONPOOL
+/* return size class for array of n rectangles, n <= POOLMAXRECTS*/
+static int
+rectclass(int n)
+{
+	int c = 0;
+
+	while ((1 << c) < n)
+		c++;
+	return c;
+}
+#endif
+
+/* allocate array of at least n rectangles, returning allocated size in *size*/
+static MWRECT *
+rectalloc(int n, int *size)
+{
+	MWRECT *rects;
+
+	region_allocs++;
+	if (n < 1)
+		n = 1;
+#if MW_FEATURE_REGIONPOOL
+	if (n <= POOLMAXRECTS) {
+		int c = rectclass(n);
+
+		n = 1 << c;
+		if (rectpool[c]) {
+			rects = rectpool[c];
+			rectpool[c] = *(void **)rects;
+			rectpoolcount[c]--;
+			*size = n;
+			return rects;
+		}
+	}
+#endif
+	region_mallocs++;
+	if ((rects = malloc(n * sizeof(MWRECT))) != NULL)
+		*size = n;
+	return rects;
+}
+
+/* free array of rectangles allocated with size entries*/
+static void
+rectfree(MWRECT *rects, int size)
+{
+	if (!rects)
+		return;
+#if MW_FEATURE_REGIONPOOL
+	if (size <= POOLMAXRECTS) {
+		int c = rectclass(size);
+
+		if (rectpoolcount[c] < POOLMAX(c)) {
+			*(void **)rects = rectpool[c];
+			rectpool[c] = rects;
+			rectpoolcount[c]++;
+			return;
+		}
+	}
+#endif
+	free(rects);
+}
+
+/**
+ * Resize a region's rectangle array, for use by region operations.
+ * Like realloc, the old array is freed unless NULL is returned.
+ *
+ * @param rects Rectangle array.
+ * @param oldsize Current size of array in rectangles.
+ * @param newsize New size of array in rectangles.
+ * @return New rectangle array, or NULL if no memory.
+ */
+MWRECT *
+GdReallocRegionRects(MWRECT *rects, int oldsize, int newsize)
+{
+#if MW_FEATURE_REGIONPOOL
+	MWRECT *newrects;
+	int size;
+
+	if (oldsize > POOLMAXRECTS && newsize > POOLMAXRECTS) {
+		region_allocs++;
+		region_mallocs++;
+		return realloc(rects, newsize * sizeof(MWRECT));
+	}
+	if (oldsize <= POOLMAXRECTS && newsize <= POOLMAXRECTS && rectclass(oldsize) == rectclass(newsize))
+		return rects;
+
+	if (!(newrects = rectalloc(newsize, &size)))
+		return NULL;
+	memcpy(newrects, rects, MWMIN(oldsize, newsize) * sizeof(MWRECT));
+	rectfree(rects, oldsize);
+	return newrects;
+#else
+	region_allocs++;
+	region_mallocs++;
+	return realloc(rects, newsize * sizeof(MWRECT));
+#endif
+}
+
+/**
+ * Return region allocation counts, for comparing across frames.
+ *
+ * @param allocs Returns number of region and rectangle array allocations.
+ * @param mallocs Returns number of those that weren't satisfied from the pool.
+ */
+void
+GdGetRegionStats(unsigned long *allocs, unsigned long *mallocs)
+{
+	*allocs = region_allocs;
+	*mallocs = region_mallocs;
+}
+
 /**
  *            Create a new empty MWCLIPREGION.
  *
@@ -318,19 +450,54 @@ GdAllocRegion(void)
 {
     MWCLIPREGION *rgn;
 
-    if ((rgn = malloc(sizeof( MWCLIPREGION ))))
+    region_allocs++;
+#if MW_FEATURE_REGIONPOOL
+    if ((rgn = regionpool) != NULL) {
+	regionpool = (MWCLIPREGION *)rgn->rects;
+	regionpoolcount--;
+    } else
+#endif
     {
-	if ((rgn->rects = malloc(sizeof( MWRECT ))))
-	{
-	    rgn->size = 1;
-	    EMPTY_REGION(rgn);
-	    return rgn;
-	}
-	free(rgn);
+	region_mallocs++;
+	if (!(rgn = malloc(sizeof( MWCLIPREGION ))))
+	    return NULL;
     }
+    if (GdInitRegion(rgn))
+	return rgn;
+    free(rgn);
     return NULL;
 }
 
+/**
+ * Initialize a caller-owned region, such as a temporary on the stack,
+ * to be empty.  Release it with GdUninitRegion rather than GdDestroyRegion.
+ *
+ * @param rgn Region to initialize.
+ * @return FALSE if no memory.
+ */
+MWBOOL
+GdInitRegion(MWCLIPREGION *rgn)
+{
+    if (!(rgn->rects = rectalloc(1, &rgn->size)))
+	return FALSE;
+    EMPTY_REGION(rgn);
+    return TRUE;
+}
+
+/**
+ * Release the rectangles of a region initialized with GdInitRegion.
+ *
+ * @param rgn Region to release.
+ */
+void
+GdUninitRegion(MWCLIPREGION *rgn)
+{
+    rectfree(rgn->rects, rgn->size);
+    rgn->rects = NULL;
+    rgn->size = 0;
+    EMPTY_REGION(rgn);
+}
+
 /**
  * Create a new MWCLIPREGION which is a rectangular region.
  *
@@ -410,7 +577,15 @@ void
 GdDestroyRegion(MWCLIPREGION *rgn)
 {
 	if(rgn) {
-		free(rgn->rects);
+		rectfree(rgn->rects, rgn->size);
+#if MW_FEATURE_REGIONPOOL
+		if (regionpoolcount < MW_REGIONPOOL_MAX) {
+			rgn->rects = (MWRECT *)regionpool;
+			regionpool = rgn;
+			regionpoolcount++;
+			return;
+		}
+#endif
 		free(rgn);
 	}
 }
@@ -511,7 +686,7 @@ GdCopyRegion(MWCLIPREGION *dst, MWCLIPREGION *src)
     {  
 	if (dst->size < src->numRects)
 	{
-	    if (! (dst->rects = REALLOC( dst->rects, dst->numRects * sizeof(MWRECT), src->numRects * sizeof(MWRECT))))
+	    if (! (dst->rects = GdReallocRegionRects( dst->rects, dst->size, src->numRects)))
 		return;
 	    dst->size = src->numRects;
 	}
@@ -752,6 +927,7 @@ REGION_RegionOp(
     MWCOORD ybot;                         /* Bottom of intersection */
     MWCOORD ytop;                         /* Top of intersection */
     MWRECT *oldRects;                   /* Old rects for newReg */
+    int oldSize;                        /* Old size of rects for newReg */
     MWCOORD prevBand;                     /* Index of start of
 						 * previous band in newReg */
     MWCOORD curBand;                      /* Index of start of current
@@ -781,6 +957,7 @@ REGION_RegionOp(
      */
 
     oldRects = newReg->rects;
+    oldSize = newReg->size;
     newReg->numRects = 0;
 
     /*
@@ -790,9 +967,7 @@ REGION_RegionOp(
      * have to worry about using too much memory. I hope to be able to
      * nuke the REALLOC() at the end of this function eventually.
      */
-    newReg->size = MWMAX(reg1->numRects,reg2->numRects) * 2;
-
-    if (! (newReg->rects = malloc( sizeof(MWRECT) * newReg->size )))
+    if (! (newReg->rects = rectalloc( MWMAX(reg1->numRects,reg2->numRects) * 2, &newReg->size )))
     {
 	newReg->size = 0;
 	return;
@@ -983,10 +1158,11 @@ REGION_RegionOp(
 	if (REGION_NOT_EMPTY(newReg))
 	{
 	    MWRECT *prev_rects = newReg->rects;
-	    newReg->rects = REALLOC( newReg->rects, sizeof(MWRECT) * newReg->size, sizeof(MWRECT) * newReg->numRects );
-	    newReg->size = newReg->numRects;
+	    newReg->rects = GdReallocRegionRects( newReg->rects, newReg->size, newReg->numRects );
 	    if (! newReg->rects)
 		newReg->rects = prev_rects;
+	    else
+		newReg->size = newReg->numRects;
 	}
 	else
 	{
@@ -994,12 +1170,11 @@ REGION_RegionOp(
 	     * No point in doing the extra work involved in an Xrealloc if
 	     * the region is empty
 	     */
-	    newReg->size = 1;
-	    free( newReg->rects );
-	    newReg->rects = malloc( sizeof(MWRECT) );
+	    rectfree( newReg->rects, newReg->size );
+	    newReg->rects = rectalloc( 1, &newReg->size );
 	}
     }
-    free( oldRects );
+    rectfree( oldRects, oldSize );
 }
 
 /* *********************************************************************
@@ -1494,15 +1669,19 @@ GdSubtractRegion(MWCLIPREGION *regD, MWCLIPREGION *regM, MWCLIPREGION *regS )
 void
 GdXorRegion(MWCLIPREGION *dr, MWCLIPREGION *sra, MWCLIPREGION *srb)
 {
-    MWCLIPREGION *tra, *trb;
+    MWCLIPREGION tra, trb;
 
-    if ((! (tra = GdAllocRegion())) || (! (trb = GdAllocRegion())))
+    if (!GdInitRegion(&tra))
+	return;
+    if (!GdInitRegion(&trb)) {
+	GdUninitRegion(&tra);
 	return;
-    GdSubtractRegion(tra,sra,srb);
-    GdSubtractRegion(trb,srb,sra);
-    GdUnionRegion(dr,tra,trb);
-    GdDestroyRegion(tra);
-    GdDestroyRegion(trb);
+    }
+    GdSubtractRegion(&tra,sra,srb);
+    GdSubtractRegion(&trb,srb,sra);
+    GdUnionRegion(dr,&tra,&trb);
+    GdUninitRegion(&tra);
+    GdUninitRegion(&trb);
 }
 
 MWCLIPREGION *
@@ -1553,6 +1732,116 @@ GdAllocBitmapRegion(MWIMAGEBITS *bitmap, MWCOORD width,	MWCOORD height)
 	return rgn;
 }
 
+/*
+ * Delayed update damage tracking for screen drivers using PSF_DELAYUPDATE.
+ *
+ * Updates are kept as a coalesced rectangle set and flushed one rectangle
+ * at a time, so small updates in opposite corners of the screen don't
+ * force a full screen copy.  Once more than DAMAGE_MAXRECTS rectangles
+ * accumulate, or the rectangles cover most of their bounding box, the
+ * bounding box is used instead.
+ */
+#define DAMAGE_MAXRECTS		16		/* max separate rects before using bounding box*/
+
+/**
+ * Add a rectangle to a damage region, allocating the region on first use.
+ *
+ * @param prgn Pointer to damage region, may point to NULL.
+ * @param x Left edge of damaged area.
+ * @param y Top edge of damaged area.
+ * @param width Width of damaged area.
+ * @param height Height of damaged area.
+ */
+void
+GdAddDamageRect(MWCLIPREGION **prgn, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	MWCLIPREGION *rgn = *prgn;
+	MWRECT rc;
+
+	if (width <= 0 || height <= 0)
+		return;
+	if (!rgn && !(rgn = *prgn = GdAllocRegion()))
+		return;
+
+	rc.left = x;
+	rc.top = y;
+	rc.right = x + width;
+	rc.bottom = y + height;
+	GdUnionRectWithRegion(&rc, rgn);
+
+	/* bound union cost by collapsing to bounding box when too fragmented*/
+	if (rgn->numRects > DAMAGE_MAXRECTS) {
+		rc = rgn->extents;
+		GdSetRectRegionIndirect(rgn, &rc);
+	}
+}
+
+/**
+ * Flush a damage region by calling the passed update routine once per
+ * rectangle, or once for the bounding box when the rectangles cover
+ * most of it, clipped to the physical screen.  The region is emptied on
+ * return.  With PSF_CURSOROVERLAY, the cursor is composited into the
+ * framebuffer during the flush.
+ *
+ * @param psd Screen device passed to update routine.
+ * @param rgn Damage region, may be NULL.
+ * @param update Driver routine to copy x, y, width, height to display.
+ */
+void
+GdFlushDamage(PSD psd, MWCLIPREGION *rgn,
+	void (*update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height))
+{
+	MWRECT *prc;
+	MWRECT rc, ext;
+	long area = 0;
+	long boxarea;
+	int i;
+#if MW_FEATURE_CURSOROVERLAY
+	MWBOOL overlay;
+#endif
+
+	if (!rgn || rgn->numRects == 0)
+		return;
+
+	/* clip to physical screen, damage may come from offscreen drawing*/
+	ext.left = MWMAX(rgn->extents.left, 0);
+	ext.top = MWMAX(rgn->extents.top, 0);
+	ext.right = MWMIN(rgn->extents.right, psd->xres);
+	ext.bottom = MWMIN(rgn->extents.bottom, psd->yres);
+	if (ext.left >= ext.right || ext.top >= ext.bottom) {
+		EMPTY_REGION(rgn);
+		return;
+	}
+
+#if MW_FEATURE_CURSOROVERLAY
+	overlay = GdDrawCursorOverlay(psd, ext.left, ext.top,
+		ext.right - ext.left, ext.bottom - ext.top);
+#endif
+
+	boxarea = (long)(ext.right - ext.left) * (ext.bottom - ext.top);
+	for (i = 0, prc = rgn->rects; i < rgn->numRects; i++, prc++)
+		area += (long)(prc->right - prc->left) * (prc->bottom - prc->top);
+
+	/* single update when rects are >= 3/4 of bounding box*/
+	if (rgn->numRects == 1 || area * 4 >= boxarea * 3)
+		update(psd, ext.left, ext.top, ext.right - ext.left, ext.bottom - ext.top);
+	else {
+		for (i = 0, prc = rgn->rects; i < rgn->numRects; i++, prc++) {
+			rc.left = MWMAX(prc->left, ext.left);
+			rc.top = MWMAX(prc->top, ext.top);
+			rc.right = MWMIN(prc->right, ext.right);
+			rc.bottom = MWMIN(prc->bottom, ext.bottom);
+			if (rc.left < rc.right && rc.top < rc.bottom)
+				update(psd, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top);
+		}
+	}
+#if MW_FEATURE_CURSOROVERLAY
+	if (overlay)
+		GdEraseCursorOverlay(psd);
+#endif
+	EMPTY_REGION(rgn);
+}
+
 #if 0
 /* *********************************************************************
  *            DumpRegion
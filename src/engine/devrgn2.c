@@ -674,7 +674,7 @@ static int REGION_PtsToRegion(int numFullPtBlocks, int iCurPtBlock,
 
     numRects = ((numFullPtBlocks * NUMPTSTOBUFFER) + iCurPtBlock) >> 1;
 
-    if (!(reg->rects = REALLOC( reg->rects, sizeof(MWRECT) * reg->size, sizeof(MWRECT) * numRects )))
+    if (!(reg->rects = GdReallocRegionRects( reg->rects, reg->size, numRects )))
         return(0);
 
     reg->size = numRects;
@@ -0,0 +1,238 @@
+/*
+ * Multithreaded band renderer for large blits and image stretches.
+ *
+ * Large blits are split into horizontal bands which are drawn in
+ * parallel by a small pool of worker threads, with the calling thread
+ * drawing one band itself.  Each band writes only its own destination
+ * rows, so no locking is needed in the blitters.  The pool is started
+ * on first use with one thread per online cpu.
+ */
+#include "device.h"
+
+#if MW_FEATURE_THREADBLIT /* whole file*/
+#include <stdlib.h>
+#include <pthread.h>
+#include "uni_std.h"
+
+#define MAXBANDS	8				/* max bands, including calling thread*/
+
+static int			tile_nthreads;	/* worker threads, -1 if unavailable*/
+static pthread_t	tile_threads[MAXBANDS - 1];
+static pthread_mutex_t tile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tile_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t tile_done = PTHREAD_COND_INITIALIZER;
+static unsigned int	tile_generation;	/* incremented for each new job*/
+static MWTILEFUNC	tile_func;		/* current job*/
+static void *		tile_arg;
+static int			tile_height;
+static int			tile_bands;		/* # bands in current job*/
+static int			tile_next;		/* next band to draw*/
+static int			tile_pending;	/* bands not yet finished*/
+
+/* draw bands of current job until none left, called with tile_mutex locked*/
+static void
+tile_runbands(void)
+{
+	while (tile_next < tile_bands) {
+		int band = tile_next++;
+		int y = tile_height * band / tile_bands;
+		int yend = tile_height * (band + 1) / tile_bands;
+
+		pthread_mutex_unlock(&tile_mutex);
+		tile_func(tile_arg, band, y, yend - y);
+		pthread_mutex_lock(&tile_mutex);
+
+		if (--tile_pending == 0)
+			pthread_cond_signal(&tile_done);
+	}
+}
+
+static void *
+tile_worker(void *arg)
+{
+	unsigned int generation = 0;
+
+	pthread_mutex_lock(&tile_mutex);
+	for (;;) {
+		while (tile_generation == generation)
+			pthread_cond_wait(&tile_start, &tile_mutex);
+		generation = tile_generation;
+		tile_runbands();
+	}
+	return NULL;
+}
+
+/* start worker threads on first use, returns # bands available*/
+static int
+tile_init(void)
+{
+	int i, ncpus;
+
+	if (tile_nthreads == 0) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		if (ncpus > MAXBANDS)
+			ncpus = MAXBANDS;
+		tile_nthreads = -1;
+		for (i = 0; i < ncpus - 1; i++) {
+			if (pthread_create(&tile_threads[i], NULL, tile_worker, NULL) != 0)
+				break;
+			pthread_detach(tile_threads[i]);
+			tile_nthreads = i + 1;
+		}
+		DPRINTF("GdTileRows: %d worker threads\n", tile_nthreads);
+	}
+	return tile_nthreads + 1;
+}
+
+/**
+ * Run func over rows 0 to height-1, split into bands that are run in parallel
+ * if the area is at least MW_THREADBLIT_MINPIXELS.  func is passed the band
+ * number, first row and number of rows, and must only write its own rows.
+ *
+ * @param height Number of rows.
+ * @param pixels Number of pixels drawn, used to decide whether to split.
+ * @param func   Band drawing function.
+ * @param arg    Passed to func.
+ */
+void
+GdTileRows(int height, long pixels, MWTILEFUNC func, void *arg)
+{
+	int bands;
+
+	if (pixels < MW_THREADBLIT_MINPIXELS || height < 2 || (bands = tile_init()) < 2) {
+		func(arg, 0, 0, height);
+		return;
+	}
+	if (bands > height)
+		bands = height;
+
+	pthread_mutex_lock(&tile_mutex);
+	tile_func = func;
+	tile_arg = arg;
+	tile_height = height;
+	tile_bands = bands;
+	tile_next = 0;
+	tile_pending = bands;
+	++tile_generation;
+	pthread_cond_broadcast(&tile_start);
+
+	/* draw bands here too, then wait for workers to finish theirs*/
+	tile_runbands();
+	while (tile_pending)
+		pthread_cond_wait(&tile_done, &tile_mutex);
+	pthread_mutex_unlock(&tile_mutex);
+}
+
+/* per-band blit state*/
+typedef struct {
+	SCREENDEVICE	sd;			/* band copy of destination, must be first*/
+	MWBLITPARMS		parms;		/* band blit parameters*/
+	int				update;		/* =1 if blitter called Update*/
+	MWCOORD			ux, uy, uw, uh;	/* Update rectangle*/
+} MWTILEBLIT;
+
+static MWTILEBLIT	tileblits[MAXBANDS];
+static PSD			tileblit_psd;
+static PMWBLITPARMS	tileblit_gc;
+static MWBLITFUNC	tileblit_func;
+static MWBOOL		tileblit_stretch;
+
+/* record driver Update from band so it can be called later from one thread*/
+static void
+tile_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	MWTILEBLIT *tb = (MWTILEBLIT *)psd;
+
+	tb->update = 1;
+	tb->ux = x;
+	tb->uy = y;
+	tb->uw = width;
+	tb->uh = height;
+}
+
+static void
+tile_blitband(void *arg, int band, int y, int height)
+{
+	MWTILEBLIT *tb = &tileblits[band];
+	PMWBLITPARMS gc = &tb->parms;
+
+	tb->sd = *tileblit_psd;
+	if (tileblit_psd->Update)
+		tb->sd.Update = tile_update;
+	tb->update = 0;
+
+	*gc = *tileblit_gc;
+	gc->dsty += y;
+	gc->height = height;
+	if (tileblit_stretch) {
+		int i;
+
+		/* step source as the stretch blitter does, so results are identical*/
+		for (i = 0; i < y; i++) {
+			gc->srcy += gc->src_y_step;
+			gc->err_y += gc->err_y_step;
+			if (gc->err_y >= 0) {
+				gc->srcy += gc->src_y_step_one;
+				gc->err_y -= gc->y_denominator;
+			}
+		}
+	} else
+		gc->srcy += y;
+
+	tileblit_func(&tb->sd, gc);
+}
+
+/**
+ * Call blitter, splitting large blits into bands drawn in parallel.
+ * Clipping and cursor checks must already be done by the caller.
+ *
+ * @param psd     Destination drawing surface.
+ * @param gc      Blit parameters, not modified.
+ * @param blit    Conversion, frame or stretch blitter.
+ * @param stretch TRUE if blit is a stretch blitter.
+ */
+void
+GdTileBlit(PSD psd, PMWBLITPARMS gc, MWBLITFUNC blit, MWBOOL stretch)
+{
+	int i, bands;
+
+	/* no split for small, sub-byte pixel or same surface (overlapping) blits*/
+	if ((long)gc->width * gc->height < MW_THREADBLIT_MINPIXELS || psd->bpp < 8 ||
+	    gc->srcpsd == psd || gc->data == gc->data_out) {
+		blit(psd, gc);
+		return;
+	}
+
+#if MW_FEATURE_PALETTE
+	/*
+	 * 8bpp blitters map colors through the inverse colormap, which is
+	 * built on first use.  Build it now rather than racing to build it
+	 * in each band, and don't split if it can't be built.
+	 */
+	if (psd->bpp == 8 && !GdGetInverseColormap(psd)) {
+		blit(psd, gc);
+		return;
+	}
+#endif
+
+	tileblit_psd = psd;
+	tileblit_gc = gc;
+	tileblit_func = blit;
+	tileblit_stretch = stretch;
+	bands = tile_init();
+	if (bands > gc->height)
+		bands = gc->height;
+	for (i = 0; i < bands; i++)
+		tileblits[i].update = 0;
+
+	GdTileRows(gc->height, (long)gc->width * gc->height, tile_blitband, NULL);
+
+	/* call driver Update for each band*/
+	for (i = 0; i < bands; i++) {
+		MWTILEBLIT *tb = &tileblits[i];
+
+		if (tb->update)
+			psd->Update(psd, tb->ux, tb->uy, tb->uw, tb->uh);
+	}
+}
+#endif /* MW_FEATURE_THREADBLIT*/
@@ -31,14 +31,14 @@
  * GdGetNextTimeout(). GdGetNextTimeout() is called with the event loop
  * timeout in ms, and fills in the specified timeout structure, which should
  * be used as the argument to the select() call. The timeout returned by the
- * GdGetNextTimeout() call is decided by looking through the timer list for
- * the timer with the shortest amount of time remaining, and also at the
- * maximum delay parameter. If there are no timers on the timer list and the
- * timeout argument is 0, it will return FALSE, otherwise it will return TRUE.
+ * GdGetNextTimeout() call is decided by the timer with the shortest amount of
+ * time remaining, and also by the maximum delay parameter. If there are no
+ * timers and the timeout argument is 0, it will return FALSE, otherwise it
+ * will return TRUE.
  *
  * When the main select() loop times out, the GdTimeout() function should be
- * called. This will go through the timer list and call the callback functions
- * of all timers which have expired, then remove them from the timer list. At
+ * called. This will call the callback functions of all timers which have
+ * expired, then remove one shot timers and reschedule periodic ones. At
  * the same time, you should check the value of the maximum timeout parameter
  * to see if it has expired (in which case you can then return to the client
  * with a timeout event). This function returns TRUE if the timeout specified in
@@ -50,50 +50,182 @@
  * complete. Especially in the case where the client is linked into the server,
  * the client must call into the server on a regular basis, otherwise the
  * timers may run late.
+ *
+ * Timers are kept in a binary min-heap ordered by expiry time, so finding
+ * the next timeout is O(1) and adding or removing a timer is O(log n).
+ * Expiry times are taken from the monotonic clock where available, so
+ * setting the wall clock doesn't stall or fire timers early.  To reduce
+ * wakeups, a timer may run up to 1/8 of its period late, but at most
+ * MW_TIMER_SLACK ms, so that timers expiring close together are all run
+ * from a single GdTimeout() call.
  */
 #include <stdlib.h>
 #include "device.h"
 
 #if MW_FEATURE_TIMERS
-
-static MWTIMER *timerlist = NULL;
+#if UNIX
+#include <time.h>
+#endif
+
+/* max ms a timer may be run late so it can share a wakeup with another timer*/
+#define TIMER_SLACK(t)	((t)->period / 8 < MW_TIMER_SLACK? (long)(t)->period / 8: MW_TIMER_SLACK)
+
+static MWTIMER **timerheap;			/* min-heap of pending timers by expiry*/
+static int ntimers;					/* # timers in heap*/
+static int maxtimers;				/* # allocated heap slots*/
+static unsigned long timerseq;		/* incremented for each timer queued*/
+static MWTIMER *firing;				/* timer whose callback is running*/
+static MWBOOL firing_destroyed;		/* firing timer was destroyed by its callback*/
+static MWBOOL mainloop_active;		/* mainloop_timeout is valid*/
 static struct timeval mainloop_timeout;
 static struct timeval current_time;
 
+static void get_current_time(void);
 static void calculate_timeval(struct timeval *tv, MWTIMEOUT to); 
 static long time_to_expiry(struct timeval *t);
 
-/**
- * Create a new one-shot timer.
- *
- * @param timeout number of milliseconds before the timer should activate
- * @param callback Callback function to call when timer fires.
- * @param arg Opaque argument to pass to callback function.
- * @return Timer handle.  NOTE that this is automatically destroyed
- * after the callback function has been called.
+/* return TRUE if timer a expires before timer b, FIFO for equal times*/
+static MWBOOL
+timer_before(MWTIMER *a, MWTIMER *b)
+{
+	if (a->timeout.tv_sec != b->timeout.tv_sec)
+		return a->timeout.tv_sec < b->timeout.tv_sec;
+	if (a->timeout.tv_usec != b->timeout.tv_usec)
+		return a->timeout.tv_usec < b->timeout.tv_usec;
+	return (long)(a->seq - b->seq) < 0;
+}
+
+static void
+heap_set(int i, MWTIMER *t)
+{
+	timerheap[i] = t;
+	t->index = i;
+}
+
+static void
+heap_up(int i)
+{
+	MWTIMER *t = timerheap[i];
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (!timer_before(t, timerheap[parent]))
+			break;
+		heap_set(i, timerheap[parent]);
+		i = parent;
+	}
+	heap_set(i, t);
+}
+
+static void
+heap_down(int i)
+{
+	MWTIMER *t = timerheap[i];
+
+	for (;;) {
+		int child = i * 2 + 1;
+		if (child >= ntimers)
+			break;
+		if (child + 1 < ntimers && timer_before(timerheap[child+1], timerheap[child]))
+			child++;
+		if (!timer_before(timerheap[child], t))
+			break;
+		heap_set(i, timerheap[child]);
+		i = child;
+	}
+	heap_set(i, t);
+}
+
+/*
+ * Return earliest expiry plus slack of timers in subtree i that is less than
+ * deadline, or deadline.  Subtrees expiring at or after deadline are skipped.
  */
-MWTIMER *GdAddTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
+static long
+heap_deadline(int i, long deadline)
+{
+	long expiry, d;
+
+	if (i >= ntimers)
+		return deadline;
+	expiry = time_to_expiry(&timerheap[i]->timeout);
+	if (expiry >= deadline)
+		return deadline;
+	d = expiry + TIMER_SLACK(timerheap[i]);
+	if (d < deadline)
+		deadline = d;
+	deadline = heap_deadline(i * 2 + 1, deadline);
+	return heap_deadline(i * 2 + 2, deadline);
+}
+
+/* queue timer, return FALSE if heap couldn't be grown*/
+static MWBOOL
+heap_insert(MWTIMER *t)
+{
+	if (ntimers >= maxtimers) {
+		int n = maxtimers? maxtimers * 2: 16;
+		MWTIMER **heap = realloc(timerheap, n * sizeof(MWTIMER *));
+		if (!heap)
+			return FALSE;
+		timerheap = heap;
+		maxtimers = n;
+	}
+	t->seq = timerseq++;
+	heap_set(ntimers, t);
+	heap_up(ntimers++);
+	return TRUE;
+}
+
+static void
+heap_remove(MWTIMER *t)
+{
+	int i = t->index;
+
+	t->index = -1;
+	if (i != --ntimers) {
+		MWTIMER *last = timerheap[ntimers];
+
+		heap_set(i, last);
+		heap_up(i);
+		heap_down(last->index);
+	}
+}
+
+static MWTIMER *
+add_timer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg, int type)
 {
 	MWTIMER *newtimer;
 
 	if(!(newtimer = malloc(sizeof(MWTIMER)))) return NULL;
 
-	gettimeofday(&current_time, NULL);
-
-	if(timerlist) timerlist->prev = newtimer;
+	get_current_time();
 
 	calculate_timeval(&newtimer->timeout, timeout);
 	newtimer->callback = callback;
 	newtimer->arg = arg;
-	newtimer->next = timerlist;
-	newtimer->prev = NULL;
-	newtimer->type   = MWTIMER_ONESHOT;
+	newtimer->type = type;
 	newtimer->period = timeout;
-	timerlist = newtimer;
+	if (!heap_insert(newtimer)) {
+		free(newtimer);
+		return NULL;
+	}
 
 	return newtimer;
 }
 
+/**
+ * Create a new one-shot timer.
+ *
+ * @param timeout number of milliseconds before the timer should activate
+ * @param callback Callback function to call when timer fires.
+ * @param arg Opaque argument to pass to callback function.
+ * @return Timer handle.  NOTE that this is automatically destroyed
+ * after the callback function has been called.
+ */
+MWTIMER *GdAddTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
+{
+	return add_timer(timeout, callback, arg, MWTIMER_ONESHOT);
+}
+
 /**
  * Create a new periodic (repeating) timer.
  *
@@ -104,24 +236,7 @@ MWTIMER *GdAddTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
  */
 MWTIMER *GdAddPeriodicTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
 {
-    MWTIMER *newtimer;
-
-    if(!(newtimer = malloc(sizeof(MWTIMER)))) return NULL;
-
-    gettimeofday (&current_time, NULL);
-    
-    if (timerlist) timerlist->prev = newtimer;
-    
-    calculate_timeval (&newtimer->timeout, timeout);
-    newtimer->callback = callback;
-    newtimer->arg      = arg;
-    newtimer->next     = timerlist;
-    newtimer->prev     = NULL;
-    newtimer->type     = MWTIMER_PERIODIC;
-    newtimer->period   = timeout;
-    timerlist          = newtimer;
-    
-    return newtimer;
+	return add_timer(timeout, callback, arg, MWTIMER_PERIODIC);
 }
 
 /**
@@ -131,12 +246,12 @@ MWTIMER *GdAddPeriodicTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
  */
 void GdDestroyTimer(MWTIMER *timer)
 {
-	if(timer->next) timer->next->prev = timer->prev;
-	if(timer->prev) timer->prev->next = timer->next;
-	if(timer == timerlist) {
-		if(timer->next) timerlist = timer->next;
-		else timerlist = timer->prev;
+	/* timer destroying itself from its callback is freed by GdTimeout*/
+	if (timer == firing) {
+		firing_destroyed = TRUE;
+		return;
 	}
+	heap_remove(timer);
 	free(timer);
 }
 
@@ -148,14 +263,15 @@ void GdDestroyTimer(MWTIMER *timer)
  */
 MWTIMER *GdFindTimer(void *arg)
 {
-	MWTIMER *t = timerlist;
+	int i;
 
-	while(t) {
-		if(t->arg == arg) break;
-		t = t->next;
-	}
+	if (firing && !firing_destroyed && firing->arg == arg)
+		return firing;
+	for (i = 0; i < ntimers; i++)
+		if (timerheap[i]->arg == arg)
+			return timerheap[i];
 
-	return t;
+	return NULL;
 }
 
 /**
@@ -167,30 +283,25 @@ MWTIMER *GdFindTimer(void *arg)
  */
 MWBOOL GdGetNextTimeout(struct timeval *tv, MWTIMEOUT timeout)
 {
-	signed long i, lowest_timeout;
-	MWTIMER *t = timerlist;
+	signed long i, lowest_timeout = 0;
 
-	if(!timeout && !timerlist) return FALSE;
+	mainloop_active = FALSE;
+	if(!timeout && !ntimers) return FALSE;
 
-	gettimeofday(&current_time, NULL);
+	get_current_time();
 
 	if(timeout) {
 		calculate_timeval(&mainloop_timeout, timeout);
-		lowest_timeout = time_to_expiry(&mainloop_timeout);
-	} else {
-		lowest_timeout = time_to_expiry(&t->timeout);
-		mainloop_timeout.tv_sec = -1;
-		t = t->next;
+		mainloop_active = TRUE;
+		lowest_timeout = timeout;
 	}
 
-	while(t) {
-		i = time_to_expiry(&t->timeout);
-		if( i>0 && i>t->period ) {
-			calculate_timeval (&t->timeout, t->period);
-			i = t->period;
-		}
-		if(i < lowest_timeout) lowest_timeout = i;
-		t = t->next;
+	/* wake when the slack of the earliest timer or any expiring within it runs out*/
+	if(ntimers) {
+		MWTIMER *t = timerheap[0];
+
+		i = heap_deadline(0, time_to_expiry(&t->timeout) + TIMER_SLACK(t));
+		if(!timeout || i < lowest_timeout) lowest_timeout = i;
 	}
 
 	if(lowest_timeout <= 0) {
@@ -209,39 +320,78 @@ MWBOOL GdGetNextTimeout(struct timeval *tv, MWTIMEOUT timeout)
  */
 MWBOOL GdTimeout(void)
 {
-	MWTIMER *n, *t = timerlist;
-	signed long tempTimeout = 0;
-
-	gettimeofday(&current_time, NULL);
-
-	while(t) {
-		n = t->next;
-		tempTimeout = time_to_expiry(&t->timeout);
-		if( tempTimeout<= 0) {
-			t->callback(t->arg);
-			if (t->type == MWTIMER_ONESHOT)
-				GdDestroyTimer(t); 		/* One shot timer, is finished delete it now */
-			else
-				calculate_timeval (&t->timeout, t->period); /* Periodic timer needs to be reset */
-		} else {
-			if( tempTimeout>0 && tempTimeout>t->period )
-				calculate_timeval (&t->timeout, t->period);
+	unsigned long startseq = timerseq;
+
+	get_current_time();
+
+	/* run all expired timers, but not ones queued by callbacks during this call*/
+	while(ntimers) {
+		MWTIMER *t = timerheap[0];
+
+		if((long)(t->seq - startseq) >= 0 || time_to_expiry(&t->timeout) > 0)
+			break;
+		heap_remove(t);
+
+		firing = t;
+		firing_destroyed = FALSE;
+		t->callback(t->arg);
+		firing = NULL;
+
+		if (t->type == MWTIMER_ONESHOT || firing_destroyed)
+			free(t);		/* One shot timer, is finished delete it now */
+		else {
+			/* Periodic timer restarts from now, aligning timers that were run together*/
+			calculate_timeval(&t->timeout, t->period);
+			if (!heap_insert(t)) {
+				EPRINTF("GdTimeout: out of memory, periodic timer dropped\n");
+				free(t);
+			}
 		}
-		t = n;
 	}
 
-	if(mainloop_timeout.tv_sec > 0 || mainloop_timeout.tv_usec > 0)
-		if(time_to_expiry(&mainloop_timeout) <= 0)
-			return TRUE;
+	if(mainloop_active && time_to_expiry(&mainloop_timeout) <= 0)
+		return TRUE;
 
 	return FALSE;
 }
 
+/* read the monotonic clock into current_time, falling back to wall clock time*/
+static void get_current_time(void)
+{
+	static long clock_offset;	/* ms added to wall clock to keep it from going backwards*/
+	struct timeval prev;
+	long back;
+
+#if UNIX && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+		current_time.tv_sec = ts.tv_sec;
+		current_time.tv_usec = ts.tv_nsec / 1000;
+		return;
+	}
+#endif
+	prev = current_time;
+	gettimeofday(&current_time, NULL);
+	current_time.tv_sec += clock_offset / 1000;
+	current_time.tv_usec += (clock_offset % 1000) * 1000;
+	if(current_time.tv_usec >= 1000000) {
+		current_time.tv_sec++;
+		current_time.tv_usec -= 1000000;
+	}
+
+	/* wall clock was set back, hold time here and adjust offset*/
+	if ((back = time_to_expiry(&prev)) > 0) {
+		clock_offset += back;
+		current_time = prev;
+	}
+}
+
 static void calculate_timeval(struct timeval *tv, MWTIMEOUT to)
 {
 	tv->tv_sec = current_time.tv_sec + (to / 1000);
 	tv->tv_usec = current_time.tv_usec + ((to % 1000) * 1000);
-	if(tv->tv_usec > 1000000) {
+	if(tv->tv_usec >= 1000000) {
 		tv->tv_sec++;
 		tv->tv_usec -= 1000000;
 	}
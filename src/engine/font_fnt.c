@@ -11,6 +11,15 @@
 #include "device.h"
 #include "devfont.h"
 #include "genfont.h"
+#include "swap.h"
+
+/* uncompressed .fnt files are in incore format on little endian machines, map directly*/
+#if HAVE_MMAP && !MW_CPU_BIG_ENDIAN
+#define FNT_MMAP	1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 /*
  * .fnt loadable font file format definition
@@ -38,6 +47,7 @@
 
 /* loadable font magic and version #*/
 #define VERSION		"RB11"
+#define HEADERSIZE	356		/* file offset of variable font data*/
 
 /* The user hase the option including ZLIB and being able to    */
 /* directly read compressed .fnt files, or to omit it and save  */
@@ -57,10 +67,21 @@
 #define FCLOSE(file)                fclose(file)
 #endif
 
+/* FNT font, MWCOREFONT with font data read or mapped from file*/
+typedef struct {
+	MWCOREFONT	core;		/* must be first*/
+	MWCFONT		cfont;
+	char *		map;		/* mmap'd font file or NULL if read*/
+	size_t		maplen;
+} MWFNTFONT, *PMWFNTFONT;
+
 /* Handling routines for FNT fonts, use MWCOREFONT structure */
 PMWFONT fnt_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr);
 static void fnt_unloadfont(PMWFONT font);
-static PMWCFONT fnt_load_font(const char *path);
+static int fnt_load_font(const char *path, PMWCFONT pf);
+#if FNT_MMAP
+static int fnt_map_font(const char *path, PMWFNTFONT pf);
+#endif
 
 /* these procs used when font ASCII indexed*/
 MWFONTPROCS fnt_fontprocs = {
@@ -100,52 +121,145 @@ static MWFONTPROCS fnt_fontprocs16 = {
 PMWFONT
 fnt_createfont(const char *name, MWCOORD height, MWCOORD width, int attr)
 {
-	PMWCOREFONT	pf;
+	char *path = mwfont_findpath(name, FNT_FONT_DIR, ".fnt");
+	if (!path)
+		return NULL;
+
+	return fnt_openfont(path);
+}
+
+/* map or read .fnt file at path and allocate MWCOREFONT structure*/
+PMWFONT
+fnt_openfont(const char *path)
+{
+	PMWFNTFONT	pf;
 	PMWCFONT	cfont;
 	int		uc16;
 
-	/* try to open file and read in font data*/
-	cfont = fnt_load_font(name);
-	if (!cfont)
+	if (!(pf = (PMWFNTFONT)calloc(1, sizeof(MWFNTFONT))))
 		return NULL;
+	cfont = &pf->cfont;
 
-	if (!(pf = (MWCOREFONT *) malloc(sizeof(MWCOREFONT)))) {
-		free(cfont);
-		return NULL;
+	/* try to map file, else open and read in font data*/
+#if FNT_MMAP
+	if (!fnt_map_font(path, pf))
+#endif
+	{
+		if (!fnt_load_font(path, cfont)) {
+			free(pf);
+			return NULL;
+		}
 	}
 
 	/* determine if unicode-16 indexing required*/
 	uc16 = cfont->firstchar > 255 || (cfont->firstchar + cfont->size) > 255;
-	pf->fontprocs = uc16? &fnt_fontprocs16: &fnt_fontprocs;
+	pf->core.fontprocs = uc16? &fnt_fontprocs16: &fnt_fontprocs;
 
-	pf->fontsize = pf->fontrotation = pf->fontattr = 0;
-	pf->name = "FNT";
-	pf->cfont = cfont;
+	pf->core.fontsize = pf->core.fontrotation = pf->core.fontattr = 0;
+	pf->core.name = "FNT";
+	pf->core.cfont = cfont;
 	return (PMWFONT)pf;
 }
 
 void
 fnt_unloadfont(PMWFONT font)
 {
-	PMWCOREFONT pf = (PMWCOREFONT)font;
-	PMWCFONT    pfc = pf->cfont;
+	PMWFNTFONT pf = (PMWFNTFONT)font;
+	PMWCFONT   pfc = &pf->cfont;
 
-	if (pfc) {
+#if FNT_MMAP
+	if (pf->map)
+		munmap(pf->map, pf->maplen);
+	else
+#endif
+	{
 		if (pfc->width)
-			free((char *)pf->cfont->width);
+			free((char *)pfc->width);
 		if (pfc->offset)
-			free((char *)pf->cfont->offset);
+			free((char *)pfc->offset);
 		if (pfc->bits)
-			free((char *)pf->cfont->bits);
-		if (pfc->name)
-			free(pf->cfont->name);
-
-		free(pfc);
+			free((char *)pfc->bits);
 	}
+	if (pfc->name)
+		free(pfc->name);
 
 	free(font);
 }
 
+#if FNT_MMAP
+static uint32_t
+GETLONG(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+ * Map an uncompressed .fnt file read-only and point font data into it.
+ * The mapping is shared between all processes using the font.
+ * Returns 0 if file can't be mapped, which includes compressed files.
+ */
+static int
+fnt_map_font(const char *path, PMWFNTFONT pf)
+{
+	int fd, i;
+	unsigned char *p;
+	size_t len, bitslen;
+	uint32_t nbits, noffset, nwidth;
+	struct stat st;
+	PMWCFONT cfont = &pf->cfont;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;
+	if (fstat(fd, &st) < 0 || st.st_size < HEADERSIZE) {
+		close(fd);
+		return 0;
+	}
+	len = st.st_size;
+	p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return 0;
+
+	/* compressed files fail magic check and are read by fnt_load_font*/
+	if (strncmp((char *)p, VERSION, 4) != 0)
+		goto errout;
+
+	nbits = GETLONG(p + 344);
+	noffset = GETLONG(p + 348);
+	nwidth = GETLONG(p + 352);
+	cfont->size = GETLONG(p + 340);
+	bitslen = ((size_t)nbits * sizeof(MWIMAGEBITS) + 3) & ~3;
+	if ((noffset && noffset != cfont->size) || (nwidth && nwidth != cfont->size) ||
+	    HEADERSIZE + bitslen + (size_t)noffset * 4 + nwidth > len)
+		goto errout;
+
+	if (!(cfont->name = malloc(64+1)))
+		goto errout;
+	memcpy(cfont->name, p + 4, 64);
+	for (i = 64; i > 0 && cfont->name[i-1] == ' '; i--)	/* remove blank pad*/
+		continue;
+	cfont->name[i] = '\0';
+
+	cfont->maxwidth = p[324] | (p[325] << 8);
+	cfont->height = p[326] | (p[327] << 8);
+	cfont->ascent = p[328] | (p[329] << 8);
+	cfont->firstchar = GETLONG(p + 332);
+	cfont->defaultchar = GETLONG(p + 336);
+	cfont->bits_size = nbits;
+	cfont->bits = (const MWIMAGEBITS *)(p + HEADERSIZE);
+	cfont->offset = noffset? (const uint32_t *)(p + HEADERSIZE + bitslen): NULL;
+	cfont->width = nwidth? p + HEADERSIZE + bitslen + noffset * 4: NULL;
+
+	pf->map = (char *)p;
+	pf->maplen = len;
+	return 1;
+
+errout:
+	munmap(p, len);
+	return 0;
+}
+#endif /* FNT_MMAP*/
+
 static int
 READBYTE(FILEP fp, unsigned char *cp)
 {
@@ -240,12 +354,11 @@ READSTRPAD(FILEP fp, char *buf, int totlen)
 	return totlen;
 }
 
-/* read and load font, return incore font structure*/
-static PMWCFONT
-fnt_load_font(const char *filename)
+/* open, read and load font into incore font structure, return 0 on error*/
+static int
+fnt_load_font(const char *path, PMWCFONT pf)
 {
 	FILEP ifp;
-	PMWCFONT pf = NULL;
 	int i;
 	unsigned short maxwidth, height, ascent, pad;
 	uint32_t firstchar, defaultchar, size;
@@ -254,12 +367,9 @@ fnt_load_font(const char *filename)
 	char copyright[256+1];
 	char name[64+1];
 
-	char *path = mwfont_findpath(filename, FNT_FONT_DIR, ".fnt");
-	if (!path)
-		return NULL;
 	ifp = FOPEN(path, "rb");
 	if (!ifp)
-		return NULL;
+		return 0;
 
 	/* read magic and version #*/
 	if (READSTR(ifp, version, 4) != 4)
@@ -267,10 +377,6 @@ fnt_load_font(const char *filename)
 	if (strncmp(version, VERSION, 4) != 0)
 		goto errout;
 
-	pf = (PMWCFONT)calloc(1, sizeof(MWCFONT));
-	if (!pf)
-		goto errout;
-
 	/* internal font name*/
 	if (READSTRPAD(ifp, name, 64) != 64)
 		goto errout;
@@ -351,12 +457,10 @@ fnt_load_font(const char *filename)
 				goto errout;
 	
 	FCLOSE(ifp);
-	return pf;	/* success!*/
+	return 1;	/* success!*/
 
 errout:
 	FCLOSE(ifp);
-	if (!pf)
-		return NULL;
 	if (pf->name)
 		free(pf->name);
 	if (pf->bits)
@@ -365,6 +469,103 @@ errout:
 		free((char *)pf->offset);
 	if (pf->width)
 		free((char *)pf->width);
-	free(pf);
-	return NULL;
+	memset(pf, 0, sizeof(MWCFONT));
+	return 0;
+}
+
+#if HAVE_PCF_CACHE
+static void
+PUTSHORT(FILE *fp, unsigned short s)
+{
+	putc(s & 0xff, fp);
+	putc(s >> 8, fp);
+}
+
+static void
+PUTLONG(FILE *fp, uint32_t l)
+{
+	PUTSHORT(fp, l & 0xffff);
+	PUTSHORT(fp, l >> 16);
+}
+
+/* write string, blank padded to totlen*/
+static void
+PUTSTRPAD(FILE *fp, const char *str, int totlen)
+{
+	while (str && *str && totlen > 0) {
+		putc(*str++, fp);
+		--totlen;
+	}
+	while (--totlen >= 0)
+		putc(' ', fp);
+}
+
+/*
+ * Save incore font as .fnt file, used to cache fonts converted from
+ * other formats.  The copyright field is set to copyright, which may be
+ * NULL.  The file is written under a temporary name and then renamed,
+ * so a partially written file is never opened.
+ * Returns 0 on error.
+ */
+int
+fnt_savefont(PMWCFONT pf, const char *path, const char *copyright)
+{
+	FILE *ofp;
+	int fd, i, ok;
+	char *tmppath;
+
+	if (!(tmppath = malloc(strlen(path) + 8)))
+		return 0;
+	sprintf(tmppath, "%s.XXXXXX", path);
+	if ((fd = mkstemp(tmppath)) < 0 || !(ofp = fdopen(fd, "wb"))) {
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmppath);
+		}
+		free(tmppath);
+		return 0;
+	}
+	fchmod(fd, 0644);
+
+	/* magic and version #, name, copyright*/
+	fwrite(VERSION, 1, 4, ofp);
+	PUTSTRPAD(ofp, pf->name, 64);
+	PUTSTRPAD(ofp, copyright, 256);
+
+	/* font info*/
+	PUTSHORT(ofp, pf->maxwidth);
+	PUTSHORT(ofp, pf->height);
+	PUTSHORT(ofp, pf->ascent);
+	PUTSHORT(ofp, 0);
+	PUTLONG(ofp, pf->firstchar);
+	PUTLONG(ofp, pf->defaultchar);
+	PUTLONG(ofp, pf->size);
+
+	/* variable font data sizes*/
+	PUTLONG(ofp, pf->bits_size);
+	PUTLONG(ofp, pf->offset? pf->size: 0);
+	PUTLONG(ofp, pf->width? pf->size: 0);
+
+	/* variable font data*/
+	for (i=0; i<pf->bits_size; ++i)
+		PUTSHORT(ofp, pf->bits[i]);
+	if (pf->bits_size & 01)
+		PUTSHORT(ofp, 0);		/* pad to 32-bit boundary*/
+	if (pf->offset)
+		for (i=0; i<pf->size; ++i)
+			PUTLONG(ofp, pf->offset[i]);
+	if (pf->width)
+		for (i=0; i<pf->size; ++i)
+			putc(pf->width[i], ofp);
+
+	ok = !ferror(ofp);
+	if (fclose(ofp) != 0)
+		ok = 0;
+	if (!ok || rename(tmppath, path) < 0) {
+		unlink(tmppath);
+		ok = 0;
+	}
+	free(tmppath);
+	return ok;
 }
+#endif /* HAVE_PCF_CACHE*/
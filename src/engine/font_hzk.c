@@ -11,6 +11,11 @@
 #include "uni_std.h"
 #include "device.h"
 #include "devfont.h"
+#if HAVE_MMAP
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 /*
  * 12x12 and 16x16 ascii and chinese fonts
@@ -338,10 +343,61 @@ static MWBOOL GetAFontInfo( PMWHZKFONT pf )
     	return TRUE;
 }
 
+/*
+ * Load a font file of at least size bytes.  With mmap the file is
+ * paged in as glyphs are drawn rather than read in whole.
+ */
+static char *
+hzk_loadfile(const char *path, int size)
+{
+#if HAVE_MMAP
+	int fd;
+	char *p;
+	struct stat st;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+	/* a short file would fault on access to the missing pages*/
+	if (fstat(fd, &st) < 0 || st.st_size < size) {
+		close(fd);
+		return NULL;
+	}
+	p = (char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	return (p == (char *)MAP_FAILED)? NULL: p;
+#else
+	FILE *fp;
+	char *p;
+
+	if (!(p = (char *)malloc(size)))
+		return NULL;
+	if (!(fp = fopen(path, "rb"))) {
+		free(p);
+		return NULL;
+	}
+	if (fread(p, sizeof(char), size, fp) < size) {
+		fclose(fp);
+		free(p);
+		return NULL;
+	}
+	fclose(fp);
+	return p;
+#endif
+}
+
+static void
+hzk_freefile(char *p, int size)
+{
+#if HAVE_MMAP
+	munmap(p, size);
+#else
+	free(p);
+#endif
+}
+
 /* This function load system font into memory.*/
 static MWBOOL LoadFont( PMWHZKFONT pf )
 {
-    	FILE* fp;
 
 	if(!GetCFontInfo(pf))
 	{
@@ -350,33 +406,14 @@ static MWBOOL LoadFont( PMWHZKFONT pf )
 	}
     	if(CFont[hzk_id(pf)].pFont == NULL)	/* check font cache*/
 	{
-		
-
- 	   	/* Allocate system memory for Chinese font.*/
- 		if( !(CFont[hzk_id(pf)].pFont = (char *)malloc(pf->CFont.size)) )
- 		{
-	 	       	EPRINTF ("Allocate memory for Chinese HZK font failure.\n");
-		        return FALSE;
-	 	}
- 	
-		/* Open font file and read information to the system memory.*/
+		/* Map or read font file into system memory.*/
  		DPRINTF ("hzk_createfont: loading '%s'\n", pf->CFont.file);
-		if(!(fp = fopen(CFont[hzk_id(pf)].file, "rb"))) 
+		if(!(CFont[hzk_id(pf)].pFont = hzk_loadfile(CFont[hzk_id(pf)].file, pf->CFont.size)))
 		{
-   		  	EPRINTF ("Error.\nThe Chinese HZK font file can not be found!\n");
+   		  	EPRINTF ("Error.\nThe Chinese HZK font file can not be loaded!\n");
    	    	 	return FALSE;
     		}
-	    	if(fread(CFont[hzk_id(pf)].pFont, sizeof(char), pf->CFont.size, fp) < pf->CFont.size) 
-		{
-	      	  	EPRINTF ("Error in reading Chinese HZK font file!\n");
-	 	     	fclose(fp);
- 	       		return FALSE;
-		}
-
-		fclose(fp);
-
 		CFont[hzk_id(pf)].use_count=0;
-
 	}
 	cfont_address = CFont[hzk_id(pf)].pFont;
 	pf->cfont_address = CFont[hzk_id(pf)].pFont;
@@ -391,35 +428,19 @@ static MWBOOL LoadFont( PMWHZKFONT pf )
 	}
     	if(AFont[hzk_id(pf)].pFont == NULL)	/* check font cache*/
 	{
-		
- 		
- 		/* Allocate system memory for ASCII font.*/
- 		if( !(AFont[hzk_id(pf)].pFont = (char *)malloc(pf->AFont.size)) )
- 		{
- 		       	EPRINTF ("Allocate memory for ASCII HZK font failure.\n");
- 		       	free(CFont[hzk_id(pf)].pFont);
- 		       	CFont[hzk_id(pf)].pFont = NULL;
-			return FALSE;
- 		}
- 	
-	 	/* Load ASCII font information to the near memory.*/
+	 	/* Map or read ASCII font file into system memory.*/
  		DPRINTF ("hzk_createfont: loading '%s'\n", pf->AFont.file );
- 		if(!(fp = fopen(AFont[hzk_id(pf)].file, "rb"))) 
+		if(!(AFont[hzk_id(pf)].pFont = hzk_loadfile(AFont[hzk_id(pf)].file, pf->AFont.size)))
 		{
- 		       	EPRINTF ("Error.\nThe ASCII HZK font file can not be found!\n");
+ 		       	EPRINTF ("Error.\nThe ASCII HZK font file can not be loaded!\n");
+			if (--CFont[hzk_id(pf)].use_count == 0)
+			{
+ 		       		hzk_freefile(CFont[hzk_id(pf)].pFont, pf->CFont.size);
+ 		       		CFont[hzk_id(pf)].pFont = NULL;
+			}
  		       	return FALSE;
  		}
-	 	if(fread(AFont[hzk_id(pf)].pFont, sizeof(char), pf->AFont.size, fp) < pf->AFont.size) 
-		{
- 		       	EPRINTF ("Error in reading ASCII HZK font file!\n");
- 		       	fclose(fp);
- 		       	return FALSE;
-	 	}
- 	
- 		fclose(fp);
- 	
 		AFont[hzk_id(pf)].use_count=0;
-
   	}
 	afont_address = AFont[hzk_id(pf)].pFont;
 	pf->afont_address = AFont[hzk_id(pf)].pFont;
@@ -438,8 +459,8 @@ static void UnloadFont( PMWHZKFONT pf )
 
 	if (!CFont[hzk_id(pf)].use_count)
 	{	
-	    	free(pf->CFont.pFont);
-	    	free(pf->AFont.pFont);
+	    	hzk_freefile(pf->CFont.pFont, pf->CFont.size);
+	    	hzk_freefile(pf->AFont.pFont, pf->AFont.size);
 
 	    	CFont[hzk_id(pf)].pFont = NULL;
 	    	AFont[hzk_id(pf)].pFont = NULL;
@@ -45,10 +45,15 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "uni_std.h"
 #include "device.h"
 #include "devfont.h"
 #include "genfont.h"
+#if HAVE_PCF_CACHE
+#include <limits.h>
+#include <sys/stat.h>
+#endif
 
 /* The user hase the option including ZLIB and being able to    */
 /* directly read compressed .pcf files, or to omit it and save  */
@@ -569,6 +574,114 @@ pcf_read_toc(FILEP file, struct toc_entry **toc, uint32_t *size)
 	return 0;
 }
 
+#if HAVE_PCF_CACHE
+/*
+ * Return cache directory, $MWFONTCACHE or PCF_CACHE_DIR-<uid>, creating
+ * it if required.  The directory must be a real directory owned by this
+ * user and not writable by others, or the cache isn't used.
+ */
+static char *
+pcf_cachedir(void)
+{
+	static char dir[PATH_MAX];
+	char *env;
+	struct stat st;
+
+	if ((env = getenv("MWFONTCACHE")) != NULL) {
+		if (strlen(env) >= sizeof(dir))
+			return NULL;
+		strcpy(dir, env);
+	} else
+		snprintf(dir, sizeof(dir), "%s-%d", PCF_CACHE_DIR, (int)geteuid());
+
+	if (lstat(dir, &st) < 0) {
+		if (mkdir(dir, 0700) < 0 || lstat(dir, &st) < 0)
+			return NULL;
+	}
+	if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+	    (st.st_mode & (S_IWGRP|S_IWOTH))) {
+		EPRINTF("pcf_createfont: font cache %s not private, not used\n", dir);
+		return NULL;
+	}
+	return dir;
+}
+
+/*
+ * Check that the cache file's copyright field, which holds the path,
+ * size and modification time of the font it was converted from, is tag.
+ */
+static int
+pcf_checkcache(const char *cachename, const char *tag)
+{
+	FILE *fp;
+	char hdr[4 + 64 + 256];
+	int i, n, len = strlen(tag);
+
+	if ((fp = fopen(cachename, "rb")) == NULL)
+		return 0;
+	n = fread(hdr, 1, sizeof(hdr), fp);
+	fclose(fp);
+	if (n != sizeof(hdr) || memcmp(hdr + 68, tag, len) != 0)
+		return 0;
+	for (i = 68 + len; i < sizeof(hdr); i++)
+		if (hdr[i] != ' ')
+			return 0;
+	return 1;
+}
+
+/*
+ * Return .fnt conversion cache filename for .pcf font file, made from
+ * the font's full path with '%' and '/' escaped so names can't collide.
+ * Fills tag with the font's path, size and time for the cache header.
+ * Sets *valid if the cache file is usable, that is a regular file owned
+ * by this user, newer than the font file and converted from it.
+ */
+static char *
+pcf_cachename(const char *path, char *tag, int *valid)
+{
+	static char cachename[PATH_MAX];
+	char fullpath[PATH_MAX];
+	char *dir, *p, *q;
+	struct stat fst, cst;
+
+	*valid = 0;
+	if (!realpath(path, fullpath) || stat(fullpath, &fst) < 0)
+		return NULL;
+	if (snprintf(tag, 257, "%s %ld %ld", fullpath, (long)fst.st_size,
+	    (long)fst.st_mtime) > 256)
+		return NULL;
+	if ((dir = pcf_cachedir()) == NULL)
+		return NULL;
+	if (strlen(dir) + strlen(fullpath) * 3 + 6 > sizeof(cachename))
+		return NULL;
+
+	/* flatten full path into filename*/
+	p = cachename + sprintf(cachename, "%s/", dir);
+	for (q = fullpath + 1; *q; q++) {
+		if (*q == '/')
+			p += sprintf(p, "%%2F");
+		else if (*q == '%')
+			p += sprintf(p, "%%25");
+		else *p++ = *q;
+	}
+	strcpy(p, ".fnt");
+
+	if (lstat(cachename, &cst) == 0 && S_ISREG(cst.st_mode) &&
+	    cst.st_mtime >= fst.st_mtime && cst.st_uid == geteuid() &&
+	    pcf_checkcache(cachename, tag))
+		*valid = 1;
+	return cachename;
+}
+
+/* save converted font in cache*/
+static void
+pcf_savecache(PMWCFONT cfont, const char *cachename, const char *tag)
+{
+	if (fnt_savefont(cfont, cachename, tag))
+		DPRINTF("pcf_createfont: cached as %s\n", cachename);
+}
+#endif /* HAVE_PCF_CACHE*/
+
 /* create font and allocate MWCOREFONT struct*/
 PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr)
 {
@@ -590,10 +703,23 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 	unsigned char *gwidth = NULL;
 	int uc16;
 	int glyph_pad;
+#if HAVE_PCF_CACHE
+	char *cachename;
+	char cachetag[257];
+	int valid;
+	PMWFONT pfont;
+#endif
 
 	char *path = mwfont_findpath(filename, PCF_FONT_DIR, ".pcf");
 	if (!path)
         return NULL;
+
+#if HAVE_PCF_CACHE
+	/* use previously converted font file if available, it is mmap'd*/
+	cachename = pcf_cachename(path, cachetag, &valid);
+	if (cachename && valid && (pfont = fnt_openfont(cachename)) != NULL)
+		return pfont;
+#endif
 	file = FOPEN(path, "rb");
 	if (!file)
 		return NULL;
@@ -783,12 +909,17 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 		((unsigned char *)pf->cfont->width)[i] = gwidth[n];
 	}
 	pf->cfont->size = encoding->count;
+	pf->cfont->bits_size = offset;
 
 	uc16 = pf->cfont->firstchar > 255 || (pf->cfont->firstchar + pf->cfont->size) > 255;
 	pf->fontprocs = uc16? &pcf_fontprocs16: &pcf_fontprocs;
 	pf->fontsize = pf->fontrotation = pf->fontattr = 0;
 	pf->name = "PCF";
 	err = 0;
+#if HAVE_PCF_CACHE
+	if (cachename)
+		pcf_savecache(pf->cfont, cachename, cachetag);
+#endif
 
 err_exit:
 	if (goffset)
@@ -32,6 +32,14 @@ void convblit_copy_rgb888_16bpp(PSD psd, PMWBLITPARMS gc);
 
 void convblit_copy_16bpp_16bpp(PSD psd, PMWBLITPARMS gc);			// 16bpp to 16bpp copy
 
+/* ----- 8bpp output -----*/
+void convblit_srcover_rgba8888_8bpp(PSD psd, PMWBLITPARMS gc);		// through inverse colormap
+void convblit_copy_rgba8888_8bpp(PSD psd, PMWBLITPARMS gc);
+void convblit_copy_rgb888_8bpp(PSD psd, PMWBLITPARMS gc);
+
+/* convblit_simd.c*/
+void convblit_simd_select(PSD psd);		// install SSE2/AVX2/NEON versions of above if available
+
 /* convblit_mask.c*/
 /* 1bpp and 8bpp (alphablend) mask conversion blits - for font display*/
 
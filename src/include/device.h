@@ -132,6 +132,8 @@ typedef struct _mwscreendevice {
 #define PSF_IMAGEHDR		0x0040	/* psd is actually MWIMAGEHDR*/
 #define PSF_DELAYUPDATE		0x0080	/* for X11&SDL, delay Update() blits until PreSelect()*/
 #define PSF_CANTBLOCK		0x0100	/* never block in select() as backend requires polling*/
+#define PSF_ADDRSHMEM		0x0200	/* psd->addr is SysV shared memory*/
+#define PSF_CURSOROVERLAY	0x0400	/* cursor composited at flush, never drawn in psd->addr*/
 
 /* Interface to Mouse Device Driver*/
 typedef struct _mousedevice {
@@ -208,6 +210,7 @@ int		GdGetPalette(PSD psd,int first, int count, MWPALENTRY *palette);
 MWCOLORVAL GdGetColorRGB(PSD psd, MWPIXELVAL pixel);
 MWPIXELVAL GdFindColor(PSD psd, MWCOLORVAL c);
 MWPIXELVAL GdFindNearestColor(MWPALENTRY *pal, int size, MWCOLORVAL cr);
+unsigned char *GdGetInverseColormap(PSD psd);
 int		GdCaptureScreen(PSD psd, char *pathname);	/* debug only*/
 void	GdPrintBitmap(PMWBLITPARMS gc, int SSZ);	/* debug only*/
 void	GdGetScreenInfo(PSD psd,PMWSCREENINFO psi);
@@ -247,6 +250,16 @@ void	GdBlit(PSD dstpsd, MWCOORD dstx, MWCOORD dsty, MWCOORD width, MWCOORD heigh
 void	GdStretchBlit(PSD dstpsd, MWCOORD dx1, MWCOORD dy1, MWCOORD dx2,
 			MWCOORD dy2, PSD srcpsd, MWCOORD sx1, MWCOORD sy1, MWCOORD sx2, MWCOORD sy2, int rop);
 
+/* devtile.c*/
+typedef void (*MWTILEFUNC)(void *arg, int band, int y, int height);
+#if MW_FEATURE_THREADBLIT
+void	GdTileRows(int height, long pixels, MWTILEFUNC func, void *arg);
+void	GdTileBlit(PSD psd, PMWBLITPARMS gc, MWBLITFUNC blit, MWBOOL stretch);
+#else
+#define GdTileRows(height,pixels,func,arg)	(func)((arg), 0, 0, (height))
+#define GdTileBlit(psd,gc,blit,stretch)		(blit)((psd), (gc))
+#endif
+
 /* devarc.c*/
 /* requires float*/
 void	GdArcAngle(PSD psd, MWCOORD x0, MWCOORD y0, MWCOORD rx, MWCOORD ry,
@@ -281,11 +294,16 @@ PMWFONT	GdCreateFontFromBuffer(PSD psd, const unsigned char *buffer,
 PMWFONT	GdDuplicateFont(PSD psd, PMWFONT psrcfont, MWCOORD height, MWCOORD width);
 char *mwfont_findpath(const char *filename, const char *defpath, const char *extension);
 char *mwfont_findalias(const char *fontname, int *height, int *width);
+#if MW_FEATURE_GLYPHCACHE
+void	GdGetGlyphCacheStats(unsigned long *hits, unsigned long *misses);
+#endif
 
 
 /* both devclip1.c and devclip2.c */
 MWBOOL	GdClipPoint(PSD psd,MWCOORD x,MWCOORD y);
 int		GdClipArea(PSD psd,MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2);
+void	GdClipDrawRow(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c);
+void	GdClipDrawCol(PSD psd, MWCOORD x, MWCOORD y1, MWCOORD y2, MWPIXELVAL c);
 #if DYNAMICREGIONS
 extern MWCLIPREGION *clipregion;
 #else
@@ -307,6 +325,10 @@ int    GdRectInRegion(MWCLIPREGION *rgn, const MWRECT *rect);
 MWBOOL GdEqualRegion(MWCLIPREGION *r1, MWCLIPREGION *r2);
 MWBOOL GdEmptyRegion(MWCLIPREGION *rgn);
 MWCLIPREGION *GdAllocRegion(void);
+MWBOOL GdInitRegion(MWCLIPREGION *rgn);
+void   GdUninitRegion(MWCLIPREGION *rgn);
+MWRECT *GdReallocRegionRects(MWRECT *rects, int oldsize, int newsize);
+void   GdGetRegionStats(unsigned long *allocs, unsigned long *mallocs);
 MWCLIPREGION *GdAllocRectRegion(MWCOORD left,MWCOORD top,MWCOORD right,MWCOORD bottom);
 MWCLIPREGION *GdAllocRectRegionIndirect(MWRECT *prc);
 void GdSetRectRegion(MWCLIPREGION *rgn, MWCOORD left, MWCOORD top, MWCOORD right, MWCOORD bottom);
@@ -322,6 +344,9 @@ void GdUnionRegion(MWCLIPREGION *d, MWCLIPREGION *s1, MWCLIPREGION *s2);
 void GdSubtractRegion(MWCLIPREGION *d, MWCLIPREGION *s1, MWCLIPREGION *s2);
 void GdXorRegion(MWCLIPREGION *d, MWCLIPREGION *s1, MWCLIPREGION *s2);
 MWCLIPREGION *GdAllocBitmapRegion(MWIMAGEBITS *bitmap, MWCOORD width, MWCOORD height);
+void GdAddDamageRect(MWCLIPREGION **prgn, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+void GdFlushDamage(PSD psd, MWCLIPREGION *rgn,
+	void (*update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height));
 
 /* devrgn2.c*/
 MWCLIPREGION *GdAllocPolygonRegion(MWPOINT *points, int count, int mode);
@@ -343,6 +368,10 @@ int 	GdHideCursor(PSD psd);
 void	GdCheckCursor(PSD psd,MWCOORD x1,MWCOORD y1,MWCOORD x2,MWCOORD y2);
 void	GdEraseCursor(PSD psd);
 void 	GdFixCursor(PSD psd);
+#if MW_FEATURE_CURSOROVERLAY
+MWBOOL	GdDrawCursorOverlay(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+void	GdEraseCursorOverlay(PSD psd);
+#endif
 void    GdSetTransform(MWTRANSFORM *);
 
 extern MOUSEDEVICE mousedev;
@@ -434,11 +463,11 @@ void	set_ts_origin(int x, int y);
 typedef void (*MWTIMERCB)(void *);
 typedef struct mw_timer MWTIMER;
 struct mw_timer {
-	struct timeval	timeout;
+	struct timeval	timeout;	/* expiry time, monotonic clock*/
 	MWTIMERCB	callback;
 	void		*arg;
-	MWTIMER		*next;
-	MWTIMER		*prev;
+	int			index;		/* position in timer heap*/
+	unsigned long seq;		/* queue order, for FIFO of equal expiry times*/
     int         type;     /* MWTIMER_ONESHOT or MWTIMER_PERIODIC */
     MWTIMEOUT   period;
 };
@@ -50,6 +50,8 @@
 #define SCREEN_DEPTH    4
 #define MW_FEATURE_AREAS 0	    /* =1 for GrArea, GrReadArea, GrStretchArea */
 #define MW_FEATURE_TINY 1	    /* =1 to drop various less-used features */
+#define MW_FEATURE_GLYPHCACHE 0	/* =1 to cache glyphs and draw text runs in one blit*/
+#define MW_FEATURE_FONTCACHE 0	/* =1 to share loaded fonts between identical GdCreateFont calls*/
 #define MW_FEATURE_CLIENTDATA 0 /* =1 for copy/paste support */
 #define TRANSLATE_ESCAPE_SEQUENCES 0	/* =1 to parse fnkeys w/tty driver*/
 #define NUKLEARUI		1		/* =0 to use older tan windows-style 3d window frame drawing/colors*/
@@ -115,6 +117,27 @@
 #ifndef MW_FEATURE_TINY
 #define MW_FEATURE_TINY 0	    /* =1 to drop various less-used features */
 #endif
+#ifndef MW_FEATURE_GLYPHCACHE
+#define MW_FEATURE_GLYPHCACHE 1	/* =1 to cache glyphs and draw text runs in one blit*/
+#endif
+#ifndef MW_FEATURE_FONTCACHE
+#define MW_FEATURE_FONTCACHE 1	/* =1 to share loaded fonts between identical GdCreateFont calls*/
+#endif
+#ifndef MW_FEATURE_THREADBLIT
+#define MW_FEATURE_THREADBLIT 0	/* =1 to draw large blits and stretches in threaded bands*/
+#endif
+#ifndef MW_THREADBLIT_MINPIXELS
+#define MW_THREADBLIT_MINPIXELS	(256*256)	/* min blit area split into bands*/
+#endif
+#ifndef MW_FEATURE_CURSOROVERLAY
+#define MW_FEATURE_CURSOROVERLAY 0	/* =1 to composite cursor at screen flush in X11/SDL*/
+#endif
+#ifndef MW_FEATURE_REGIONPOOL
+#define MW_FEATURE_REGIONPOOL 1	/* =1 to allocate regions from free lists*/
+#endif
+#ifndef MW_REGIONPOOL_MAX
+#define MW_REGIONPOOL_MAX	16	/* max free regions and rect arrays kept per size*/
+#endif
 #if MW_FEAATURE_CLIENTDATA
 #define MW_FEATURE_CLIENTDATA 1 /* =1 for copy/paste support */
 #endif
@@ -124,6 +147,10 @@
 #define HAVE_SELECT		1		/* =1 has select system call*/
 #endif
 
+#ifndef HAVE_EPOLL
+#define HAVE_EPOLL		0		/* =1 use epoll instead of select in GsSelect (Linux)*/
+#endif
+
 #ifndef HAVE_SIGNAL
 #define HAVE_SIGNAL		1		/* =1 has signal system call*/
 #endif
@@ -140,6 +167,10 @@
 #define MW_FEATURE_TIMERS 1		/* =1 to include MWTIMER support */
 #endif
 
+#ifndef MW_TIMER_SLACK
+#define MW_TIMER_SLACK	10		/* max ms timers may run late to share a wakeup*/
+#endif
+
 #ifndef MW_FEATURE_IMAGES
 #define MW_FEATURE_IMAGES 1		/* =1 to enable GdLoadImage/GdDrawImage etc*/
 #endif
@@ -203,6 +234,10 @@
 #define PCF_FONT_DIR	    "fonts/pcf"         /* default .pcf file location*/
 #endif
 
+#ifndef PCF_CACHE_DIR
+#define PCF_CACHE_DIR	    "/tmp/mwfonts"      /* converted .pcf to .fnt cache, -<uid> appended*/
+#endif
+
 #ifndef FREETYPE_FONT_DIR
 #define FREETYPE_FONT_DIR   "fonts/truetype"	/* default .ttf/.otf/.pfr font directory*/
 #endif
@@ -231,6 +266,10 @@
 #define HAVE_PCFGZ_SUPPORT		0	/* gzipped PCF font support*/
 #endif
 
+#ifndef HAVE_PCF_CACHE
+#define HAVE_PCF_CACHE			0	/* cache converted PCF fonts as .fnt files*/
+#endif
+
 #ifndef HAVE_FREETYPE_2_SUPPORT
 #define HAVE_FREETYPE_2_SUPPORT	0	/* Truetype font support*/
 #endif
@@ -297,6 +336,20 @@
 #define HAVE_SHAREDMEM_SUPPORT 0 /* =1 to use shared memory between NX client/server*/
 #endif
 
+#ifndef MW_FEATURE_SERVERSTATS
+#define MW_FEATURE_SERVERSTATS 0	/* =1 to keep per-client/per-request server statistics*/
+#endif
+
+#ifndef MW_FEATURE_BACKINGSTORE
+#define MW_FEATURE_BACKINGSTORE 0	/* =1 to restore uncovered top level windows from pixmaps*/
+#endif
+#ifndef MW_BACKINGSTORE_MAXKB
+#define MW_BACKINGSTORE_MAXKB	4096	/* max total backing store pixmap memory in kbytes*/
+#endif
+#ifndef MW_CLIENT_OUTMAXKB
+#define MW_CLIENT_OUTMAXKB	16384	/* max queued output per client in kbytes before drop*/
+#endif
+
 #ifndef UPDATEREGIONS
 #define UPDATEREGIONS	1		/* =1 win32 api paints only in updated regions*/
 #endif
@@ -317,6 +370,10 @@
 #define NOCLIPPING		0		/* =1 to generate engine with no clipping*/
 #endif
 
+#ifndef MW_FEATURE_SIMD
+#define MW_FEATURE_SIMD	1		/* =1 for SSE2/AVX2/NEON conversion blits when available*/
+#endif
+
 #ifndef NOFONTS
 #define NOFONTS			0		/* =1 to generate engine with no builtin fonts*/
 #endif
@@ -329,6 +386,16 @@
 #define VTSWITCH		0		/* =1 to include virtual terminal switching code*/
 #endif
 
+#ifndef MW_FEATURE_FBSHADOW
+#define MW_FEATURE_FBSHADOW	0	/* =1 for linux fb drawing into system memory shadow*/
+#endif
+#ifndef MW_FBSHADOW_PAGEFLIP
+#define MW_FBSHADOW_PAGEFLIP 0	/* =1 to double buffer shadow flushes with FBIOPAN_DISPLAY*/
+#endif
+#ifndef MW_FBSHADOW_VSYNC
+#define MW_FBSHADOW_VSYNC	0	/* =1 to wait for vertical retrace on shadow flushes*/
+#endif
+
 #ifndef USE_EXPOSURE
 #define USE_EXPOSURE	1		/* =1 to repaint from framebuffer on X11 expose event*/
 #endif
@@ -378,6 +445,16 @@ int	GdError(const char *format, ...);
 #error VTSWITCH depends on MW_FEATURE_TIMERS - disable VTSWITCH in config or enable MW_FEATURE_TIMERS in Arch.rules
 #endif
 
+/* Sanity check: PCF cache files are loaded by the FNT font engine. */
+#if HAVE_PCF_CACHE && !HAVE_FNT_SUPPORT
+#error HAVE_PCF_CACHE depends on HAVE_FNT_SUPPORT - disable HAVE_PCF_CACHE in config
+#endif
+
+/* Sanity check: BACKINGSTORE saves window visible regions. */
+#if MW_FEATURE_BACKINGSTORE && !DYNAMICREGIONS
+#error BACKINGSTORE depends on DYNAMICREGIONS - disable BACKINGSTORE in config
+#endif
+
 /* no assert() in MSDOS or PSP */
 #if MSDOS | PSP
 #undef assert
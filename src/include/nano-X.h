@@ -72,6 +72,14 @@ typedef struct {
 	GR_SIZE  height;	/**< rectangle height*/
 } GR_RECT;
 
+/** GrTexts string and position*/
+typedef struct {
+	GR_COORD x;		/**< x coordinate relative to drawable*/
+	GR_COORD y;		/**< y coordinate relative to drawable*/
+	void *	 str;		/**< text string*/
+	GR_COUNT count;		/**< character count, -1 for strlen if ascii*/
+} GR_TEXTITEM;
+
 /* The root window id. */
 #define	GR_ROOT_WINDOW_ID	((GR_WINDOW_ID) 1)
 
@@ -689,6 +697,26 @@ typedef void (*GR_FNCALLBACKEVENT)(GR_EVENT *);
  */
 #define GR_GRAB_MAX                     GR_GRAB_EXCLUSIVE_MOUSE
 
+/**
+ * Statistics for one request type, returned by GrGetServerStats.
+ */
+typedef struct {
+  unsigned long	count;		/**< # requests handled */
+  unsigned long	bytes;		/**< total request size in bytes */
+  double	time;		/**< total server time handling requests, in seconds */
+} GR_REQUEST_STATS;
+
+#define GR_STATS_MAXREQ		256	/* max request types in GR_SERVER_STATS*/
+
+/**
+ * Server statistics, indexed by request number (see nxproto.h).
+ */
+typedef struct {
+  int		numreqs;	/**< # valid entries in reqs[] */
+  int		nclients;	/**< # connected clients */
+  GR_REQUEST_STATS reqs[GR_STATS_MAXREQ]; /**< per-request statistics */
+} GR_SERVER_STATS;
+
 /* GrGetSysColor colors*/
 /* desktop background*/
 #define GR_COLOR_DESKTOP           0
@@ -763,6 +791,9 @@ GR_WINDOW_ID	GrNewWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height, GR_SIZE bordersize,
 				GR_COLOR background, GR_COLOR bordercolor);
 GR_WINDOW_ID    GrNewPixmapEx(GR_SIZE width, GR_SIZE height, int format, void *pixels);
+GR_WINDOW_ID	GrNewSharedPixmap(GR_SIZE width, GR_SIZE height, int format,
+			void **pixels, int *pitch);
+void		GrDestroySharedPixmap(GR_WINDOW_ID pid, void *pixels);
 GR_WINDOW_ID	GrNewInputWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height);
 void		GrDestroyWindow(GR_WINDOW_ID wid);
@@ -833,6 +864,8 @@ void		GrPoints(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 void		GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height);
 void		GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height);
+void		GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable);
+void		GrLines(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry);
@@ -884,6 +917,8 @@ void		GrFreeImage(GR_IMAGE_ID id);
 void		GrGetImageInfo(GR_IMAGE_ID id, GR_IMAGE_INFO *iip);
 void		GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				void *str, GR_COUNT count, GR_TEXTFLAGS flags);
+void		GrTexts(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_TEXTITEM *items,
+				GR_TEXTFLAGS flags);
 GR_CURSOR_ID GrNewCursor(GR_SIZE width, GR_SIZE height, GR_COORD hotx, GR_COORD hoty,
 				GR_COLOR foreground, GR_COLOR background, GR_BITMAP *fgbitmap, GR_BITMAP *bgbitmap);
 void		GrDestroyCursor(GR_CURSOR_ID cid);
@@ -917,6 +952,7 @@ void		GrUngrabKey(GR_WINDOW_ID wid, GR_KEY key);
 GR_TIMER_ID	GrCreateTimer(GR_WINDOW_ID wid, GR_TIMEOUT period);
 void		GrDestroyTimer(GR_TIMER_ID tid);
 void		GrSetPortraitMode(int portraitmode);
+GR_BOOL		GrGetServerStats(int pid, GR_SERVER_STATS *sp);
 
 void		GrRegisterInput(int fd);
 void		GrUnregisterInput(int fd);
@@ -22,7 +22,7 @@ MwSetClipWindow(HDC hdc)
 	HWND		sibwp;		/* sibling windows */
 	MWCOORD		diff;		/* difference in coordinates */
 	PRECT		prc;		/* client or window rectangle*/
-	MWCLIPREGION	*vis, *r;
+	MWCLIPREGION	*vis, r;
 	MWCOORD		x, y, width, height;
 
 	/*
@@ -80,9 +80,9 @@ MwSetClipWindow(HDC hdc)
 	vis = GdAllocRectRegion(x, y, x+width, y+height);
 
 	/* 
-	 * Allocate temp region
+	 * Initialize temp region
 	 */
-	r = GdAllocRegion();
+	GdInitRegion(&r);
 
 	/*
 	 * Now examine all windows that obscure this window, and
@@ -111,8 +111,8 @@ MwSetClipWindow(HDC hdc)
 			if (sibwp->unmapcount)
 				continue;
 
-			GdSetRectRegionIndirect(r, &sibwp->winrect);
-			GdSubtractRegion(vis, vis, r);
+			GdSetRectRegionIndirect(&r, &sibwp->winrect);
+			GdSubtractRegion(vis, vis, &r);
 		}
 
 		/* if not clipping the root window, stop when you reach it*/
@@ -133,8 +133,8 @@ MwSetClipWindow(HDC hdc)
 			if (sibwp->unmapcount)
 				continue;
 
-			GdSetRectRegionIndirect(r, &sibwp->winrect);
-			GdSubtractRegion(vis, vis, r);
+			GdSetRectRegionIndirect(&r, &sibwp->winrect);
+			GdSubtractRegion(vis, vis, &r);
 		}
 	}
 
@@ -156,7 +156,7 @@ MwSetClipWindow(HDC hdc)
 	GdSetClipRegion(hdc->psd, vis);
 
 	/*
-	 * Destroy temp region
+	 * Release temp region
 	 */
-	GdDestroyRegion(r);
+	GdUninitRegion(&r);
 }
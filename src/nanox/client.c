@@ -573,6 +573,34 @@ GrGetSysColor(int index)
 	return color;
 }
 
+/**
+ * Get server request statistics, if the server was built with SERVERSTATS=Y.
+ * Each entry of sp->reqs holds the count, size and server time of requests
+ * of that type, indexed by request number.
+ *
+ * @param pid Process id of the client to report, or 0 for all clients.
+ * @param sp  Pointer to the GR_SERVER_STATS structure to store the result.
+ * @return    GR_TRUE on success, GR_FALSE if unsupported or pid not found.
+ *
+ * @ingroup nanox_misc
+ */
+GR_BOOL
+GrGetServerStats(int pid, GR_SERVER_STATS *sp)
+{
+	nxGetServerStatsReq *req;
+	GR_BOOL ret;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(GetServerStats);
+	req->pid = pid;
+	if(TypedReadBlock(&ret, sizeof(ret), GrNumGetServerStats) == -1)
+		ret = GR_FALSE;
+	else if(ret && ReadBlock(sp, sizeof(*sp)) == -1)
+		ret = GR_FALSE;
+	UNLOCK(&nxGlobalLock);
+	return ret;
+}
+
 /**
  * Gets information about a font.
  *
@@ -1351,6 +1379,80 @@ GrNewPixmapEx(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 	return wid;
 }
 
+/**
+ * Create a new server side pixmap whose pixel memory is shared with
+ * the application.  The application writes pixels directly in the
+ * pixmap's format and then draws them with a single GrCopyArea,
+ * rather than sending pixel data through GrArea requests.
+ *
+ * The server reads the pixels when it executes the GrCopyArea, so
+ * they must not be changed again until after a round trip call such
+ * as GrGetWindowInfo, or use two pixmaps alternately.
+ *
+ * @param width  The width of the pixmap.
+ * @param height The height of the pixmap.
+ * @param format The MWIF image format for the pixmap, 0 for screen format.
+ * @param pixels Returns the address of the pixmap memory.
+ * @param pitch  Returns the length in bytes of each pixmap line.
+ * @return       The ID of the newly created pixmap, 0 if shared memory
+ *               isn't available.
+ *
+ * @ingroup nanox_window
+ */
+GR_WINDOW_ID
+GrNewSharedPixmap(GR_SIZE width, GR_SIZE height, int format, void **pixels, int *pitch)
+{
+#if HAVE_SHAREDMEM_SUPPORT
+	nxNewSharedPixmapReq *req;
+	nxNewSharedPixmapReply reply;
+	void *		addr;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(NewSharedPixmap);
+	req->width = width;
+	req->height = height;
+	req->format = format;
+	if(TypedReadBlock(&reply, sizeof(reply), GrNumNewSharedPixmap) == -1 || !reply.wid) {
+		UNLOCK(&nxGlobalLock);
+		return 0;
+	}
+
+	addr = shmat(reply.shmid, 0, 0);
+	shmctl(reply.shmid, IPC_RMID, 0);	/* removed when server and client detach*/
+	if (addr == (void *)-1) {
+		EPRINTF("nxclient: Can't attach shared pixmap %d: %d\n", reply.shmid, errno);
+		GrDestroyWindow(reply.wid);
+		UNLOCK(&nxGlobalLock);
+		return 0;
+	}
+	*pixels = addr;
+	*pitch = reply.pitch;
+	UNLOCK(&nxGlobalLock);
+	return reply.wid;
+#else
+	return 0;
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+}
+
+/**
+ * Destroy a pixmap created with GrNewSharedPixmap and release
+ * the application's mapping of its pixels.
+ *
+ * @param pid    The ID of the shared pixmap.
+ * @param pixels The pixel address returned by GrNewSharedPixmap.
+ *
+ * @ingroup nanox_window
+ */
+void
+GrDestroySharedPixmap(GR_WINDOW_ID pid, void *pixels)
+{
+	GrDestroyWindow(pid);
+#if HAVE_SHAREDMEM_SUPPORT
+	if (pixels)
+		shmdt(pixels);
+#endif
+}
+
 /**
  * Create a new input-only window with the specified dimensions which is a
  * child of the specified parent window.
@@ -2787,6 +2889,41 @@ GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2,
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Draw a set of separate lines on the specified drawable using the specified
+ * graphics context.  The point table holds the start and end points of each
+ * line, so is 2 * count points long.  This is the same as calling GrLine for
+ * each line, but sends far fewer requests.
+ *
+ * @param id  the ID of the drawable to draw the lines on
+ * @param gc  the ID of the graphics context to use when drawing the lines
+ * @param count  the number of lines
+ * @param pointtable  pointer to a GR_POINT array of line end point pairs
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrLines(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
+{
+	nxLinesReq *req;
+	GR_COUNT	n;
+	GR_COUNT	maxlines;
+
+	/* split into requests no larger than MAXREQUESTSZ*/
+	maxlines = (MAXREQUESTSZ - sizeof(nxLinesReq)) / (2 * sizeof(GR_POINT));
+	LOCK(&nxGlobalLock);
+	while (count > 0) {
+		n = (count > maxlines)? maxlines: count;
+		req = AllocReqExtra(Lines, (int32_t)n * 2 * sizeof(GR_POINT));
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), pointtable, n * 2 * sizeof(GR_POINT));
+		pointtable += n * 2;
+		count -= n;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
 /**
  * Draw the boundary of a rectangle of the specified dimensions and position
  * on the specified drawable using the specified graphics context.
@@ -2847,6 +2984,40 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Draw an array of filled rectangles on the specified drawable using the
+ * specified graphics context.  This is the same as calling GrFillRect
+ * for each rectangle, but sends far fewer requests.
+ *
+ * @param id  the ID of the drawable to draw the rectangles on
+ * @param gc  the ID of the graphics context to use when drawing the rectangles
+ * @param count  the number of rectangles in the rectangle table
+ * @param recttable  pointer to a GR_RECT array of rectangles to fill
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	nxFillRectsReq *req;
+	GR_COUNT	n;
+	GR_COUNT	maxrects;
+
+	/* split into requests no larger than MAXREQUESTSZ*/
+	maxrects = (MAXREQUESTSZ - sizeof(nxFillRectsReq)) / sizeof(GR_RECT);
+	LOCK(&nxGlobalLock);
+	while (count > 0) {
+		n = (count > maxrects)? maxrects: count;
+		req = AllocReqExtra(FillRects, (int32_t)n * sizeof(GR_RECT));
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), recttable, n * sizeof(GR_RECT));
+		recttable += n;
+		count -= n;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
 /**
  * Draws the boundary of ellipse at the specified position using the specified
  * dimensions and graphics context on the specified drawable.
@@ -3771,6 +3942,68 @@ GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, void *str,
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Draws an array of text strings at their positions on the specified
+ * drawable using the specified graphics context and flags.  This is the
+ * same as calling GrText for each string, but sends far fewer requests.
+ *
+ * @param id  the ID of the drawable to draw the text strings onto
+ * @param gc  the ID of the graphics context to use when drawing the strings
+ * @param count  the number of items in the text item array
+ * @param items  pointer to an array of text strings and positions
+ * @param flags  flags specifying text encoding, alignment, etc.
+ *
+ * @ingroup nanox_font
+ */
+void
+GrTexts(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_TEXTITEM *items,
+	GR_TEXTFLAGS flags)
+{
+	nxTextsReq *req;
+	nxTextItem *tp;
+	char *		data;
+	GR_COUNT	i, n;
+	int32_t		size;
+	GR_COUNT	counts[64];		/* char counts*/
+	int		sizes[64];		/* byte counts*/
+
+	LOCK(&nxGlobalLock);
+	while (count > 0) {
+		/* pack as many items as fit in MAXREQUESTSZ, at least one*/
+		size = 0;
+		for (n = 0; n < count && n < 64; n++) {
+			counts[n] = items[n].count;
+			/* use strlen as char count when ascii or dbcs*/
+			if(counts[n] == -1 && (flags&MWTF_PACKMASK) == MWTF_ASCII)
+				counts[n] = strlen((char *)items[n].str);
+			sizes[n] = nxCalcStringBytes(items[n].str, counts[n], flags);
+			i = sizeof(nxTextItem) + ((sizes[n] + (ALIGNSZ-1)) & ~(ALIGNSZ-1));
+			if (n && sizeof(nxTextsReq) + size + i > MAXREQUESTSZ)
+				break;
+			size += i;
+		}
+
+		req = AllocReqExtra(Texts, size);
+		req->drawid = id;
+		req->gcid = gc;
+		req->flags = flags;
+		data = GetReqData(req);
+		for (i = 0; i < n; i++) {
+			tp = (nxTextItem *)data;
+			tp->x = items[i].x;
+			tp->y = items[i].y;
+			tp->count = counts[i];
+			tp->size = sizes[i];
+			data += sizeof(nxTextItem);
+			memcpy(data, items[i].str, sizes[i]);
+			data += (sizes[i] + (ALIGNSZ-1)) & ~(ALIGNSZ-1);
+		}
+		items += n;
+		count -= n;
+	}
+	UNLOCK(&nxGlobalLock);
+}
+
 
 /**
  * Retrieves the system palette and places it in the specified palette
@@ -1397,4 +1397,70 @@ typedef struct {
 	IDTYPE	imageid;
 } nxDrawImagePartToFitReq;
 
-#define GrTotalNumCalls         126
+#define GrNumNewSharedPixmap        126
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	width;
+	INT16	height;
+	UINT32	format;
+} nxNewSharedPixmapReq;
+
+/* GrNewSharedPixmap reply*/
+typedef struct {
+	IDTYPE	wid;		/* pixmap id, 0 on failure*/
+	UINT32	shmid;		/* shared memory id of pixel buffer*/
+	UINT32	pitch;		/* bytes per line*/
+	UINT32	size;		/* size of pixel buffer*/
+} nxNewSharedPixmapReply;
+
+#define GrNumFillRects              127
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*GR_RECT recttable[];*/
+} nxFillRectsReq;
+
+#define GrNumLines                  128
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*GR_POINT pointtable[];*/	/* 2 points per line*/
+} nxLinesReq;
+
+#define GrNumTexts                  129
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	UINT32	flags;
+	/*nxTextItem items[];*/
+} nxTextsReq;
+
+/* GrTexts item, followed by size bytes of text padded to ALIGNSZ*/
+typedef struct {
+	INT16	x;
+	INT16	y;
+	INT16	count;
+	UINT16	size;
+	/*BYTE8	text[];*/
+} nxTextItem;
+
+#define GrNumGetServerStats         130
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	UINT32	pid;
+} nxGetServerStatsReq;
+
+#define GrTotalNumCalls         131
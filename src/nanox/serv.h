@@ -173,6 +173,12 @@ struct gr_event_list {
 	GR_EVENT	event;		/* event */
 };
 
+#define GS_INBUFSZ	(MAXREQUESTSZ * 2)	/* client request input buffer size*/
+#define GS_OUTBUFSZ	4096			/* initial client output queue size*/
+
+/* client has output queued that its socket hasn't taken yet*/
+#define GsOutputPending(client)	((client)->outend != (client)->outstart)
+
 /*
  * Data structure to keep track of state of clients.
  */
@@ -188,6 +194,16 @@ struct gr_client {
 	int		shm_cmds_size;
 	int		shm_cmds_shmid;
 	int		processid;	/* client process id*/
+	char		*inbuf;		/* request input buffer, GS_INBUFSZ bytes*/
+	int		instart;	/* offset of next request in inbuf*/
+	int		inend;		/* offset of end of data in inbuf*/
+	char		*outbuf;	/* queued output not yet sent or NULL*/
+	int		outstart;	/* offset of next byte to send in outbuf*/
+	int		outend;		/* offset of end of data in outbuf*/
+	int		outsize;	/* allocated size of outbuf*/
+#if MW_FEATURE_SERVERSTATS
+	GR_REQUEST_STATS *stats;	/* per-request statistics or NULL*/
+#endif
 };
 
 /*
@@ -344,6 +360,15 @@ struct gr_window {
 	char		*title;		/* window title*/
 	MWCLIPREGION*clipregion;/* window clipping region */
 	GR_PIXMAP	*buffer;	/* window buffer pixmap*/
+	MWCLIPREGION*visregion;	/* cached visible region, DYNAMICREGIONS only*/
+	unsigned long	visgeneration;	/* clipgeneration when visregion was computed*/
+	int		visflags;	/* GsSetClipWindow flags for visregion*/
+#if MW_FEATURE_BACKINGSTORE
+	PSD		backing;	/* backing store pixmap, top level windows only*/
+	MWCLIPREGION*backvalid;	/* window area saved in backing store*/
+	GR_WINDOW	*backnext;	/* backing store LRU list, most recent first*/
+	GR_WINDOW	*backprev;
+#endif
 };
 
 /*
@@ -361,6 +386,7 @@ struct gr_pixmap {
 
 	GR_PIXMAP	*next;		/* next pixmap in list */
 	GR_CLIENT	*owner;		/* client that created it */
+	int		shmid;		/* shared memory id if PSF_ADDRSHMEM*/
 };
 
 /**
@@ -413,6 +439,17 @@ void		GsTileBackgroundPixmap(GR_WINDOW *wp, GR_PIXMAP *pm,
 				GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height);
 void		GsInitWindowBuffer(GR_WINDOW *wp, GR_SIZE width, GR_SIZE height);
 void		GsFreeWindowBuffer(GR_WINDOW *wp);
+#if MW_FEATURE_BACKINGSTORE
+void		GsFreeBacking(GR_WINDOW *wp);
+void		GsFreeAllBacking(void);
+void		GsBackingInvalidate(GR_WINDOW *wp);
+void		GsBackingSave(GR_WINDOW *wp, GR_COORD rootx, GR_COORD rooty,
+				GR_SIZE width, GR_SIZE height);
+void		GsBackingSaveArea(GR_WINDOW *skipwp, GR_COORD rootx, GR_COORD rooty,
+				GR_SIZE width, GR_SIZE height);
+GR_BOOL		GsBackingRestore(GR_WINDOW *wp, GR_COORD rootx, GR_COORD rooty,
+				GR_SIZE width, GR_SIZE height);
+#endif
 void		GsClearWindow(GR_WINDOW *wp, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height, int exposeflag);
 void		GsUnrealizeWindow(GR_WINDOW *wp, GR_BOOL temp_unmap);
@@ -423,6 +460,10 @@ void		GsDestroyPixmap(GR_PIXMAP *pp);
 void		GsSetPortraitMode(int mode);
 void		GsSetPortraitModeFromXY(GR_COORD rootx, GR_COORD rooty);
 void		GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags);
+#define GS_CLIP_NOCACHE	0x8000		/* GsSetClipWindow flag: don't use window visregion*/
+#if DYNAMICREGIONS
+MWCLIPREGION *GsCalcVisRegion(GR_WINDOW *wp, int flags);
+#endif
 void		GsHandleMouseStatus(GR_COORD newx, GR_COORD newy, int newbuttons);
 void		GsFreePositionEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_WINDOW_ID subwid);
 void		GsDeliverButtonEvent(GR_EVENT_TYPE type, int buttons, int changebuttons, int modifiers);
@@ -447,6 +488,14 @@ void		GsDeliverSelectionChangedEvent(GR_WINDOW_ID old_owner, GR_WINDOW_ID new_ow
 void		GsDeliverTimerEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_TIMER_ID tid);
 #endif
 
+/* resource types for GsAddResource/GsLookupResource id hash table*/
+#define GR_RES_WINDOW	1
+#define GR_RES_PIXMAP	2
+#define GR_RES_GC		3
+#define GR_RES_REGION	4
+#define GR_RES_FONT		5
+#define GR_RES_CURSOR	6
+
 void		GsCheckMouseWindow(void);
 void		GsCheckFocusWindow(void);
 GR_DRAW_TYPE GsPrepareDrawing(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp);
@@ -458,6 +507,9 @@ GR_GC		*GsFindGC(GR_GC_ID gcid);
 GR_REGION	*GsFindRegion(GR_REGION_ID regionid);
 GR_FONT 	*GsFindFont(GR_FONT_ID fontid);
 GR_CURSOR 	*GsFindCursor(GR_CURSOR_ID cursorid);
+void		GsAddResource(int type, GR_ID id, void *ptr);
+void		GsRemoveResource(int type, GR_ID id);
+void		*GsLookupResource(int type, GR_ID id);
 GR_WINDOW	*GsPrepareWindow(GR_WINDOW_ID wid);
 GR_WINDOW	*GsFindVisibleWindow(GR_COORD x, GR_COORD y);
 void		GsDrawBorder(GR_WINDOW *wp);
@@ -467,6 +519,11 @@ int		GsOpenSocket(void);
 void		GsCloseSocket(void);
 void		GsAcceptClient(void);
 void		GsAcceptClientFd(int i);
+#if HAVE_EPOLL
+void		GsEpollAdd(int fd);
+void		GsEpollDel(int fd);
+void		GsEpollOutput(int fd, GR_BOOL output);
+#endif
 int		GsPutCh(int fd, unsigned char c);
 GR_CLIENT	*GsFindClient(int fd);
 void		GsDestroyClientResources(GR_CLIENT * client);
@@ -474,6 +531,10 @@ void		GsDropClient(int fd);
 int		GsRead(int fd, void *buf, int c);
 int		GsWrite(int fd, void *buf, int c);
 void		GsHandleClient(int fd);
+void		GsFlushClient(GR_CLIENT *client);
+#if MW_FEATURE_SERVERSTATS
+void		GsDumpServerStats(void);
+#endif
 void		GsResetScreenSaver(void);
 void		GsActivateScreenSaver(void *arg);
 void		GrGetNextEventWrapperFinish(int);
@@ -498,6 +559,8 @@ extern	GR_WINDOW	*listwp;		/* list of all windows */
 extern	GR_PIXMAP	*listpp;		/* list of all pixmaps */
 extern	GR_WINDOW	*rootwp;		/* root window pointer */
 extern	GR_WINDOW	*clipwp;		/* window clipping is set for */
+extern	GR_PIXMAP	*clippp;		/* pixmap clipping is set for */
+extern	unsigned long	clipgeneration;		/* incremented on window stacking/geometry change*/
 extern	GR_WINDOW	*focuswp;		/* focus window for keyboard */
 extern	GR_WINDOW	*mousewp;		/* window mouse is currently in */
 extern	GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -506,12 +569,19 @@ extern	GR_COORD	cursorx;		/* x position of cursor */
 extern	GR_COORD	cursory;		/* y position of cursor */
 extern	GR_BUTTON	curbuttons;		/* current state of buttons */
 extern	GR_CLIENT	*curclient;		/* current client */
+extern	GR_CLIENT	*root_client;		/* root entry of the client table */
 extern	char		*current_shm_cmds;
 extern	int		current_shm_cmds_size;
 extern	GR_EVENT_LIST	*eventfree;		/* list of free events */
 extern	GR_BOOL		focusfixed;		/* TRUE if focus is fixed */
 extern	PMWFONT		stdfont;		/* default font*/
 extern	int		connectcount;		/* # of connections to server */
+#if MW_FEATURE_BACKINGSTORE
+extern	long		backingmax;		/* backing store memory limit in bytes*/
+#endif
+#if MW_FEATURE_SERVERSTATS
+extern	GR_REQUEST_STATS GsServerStats[];	/* all client per-request statistics*/
+#endif
 #if MW_FEATURE_TIMERS
 extern	GR_TIMEOUT	screensaver_delay;	/* time before screensaver activates*/
 extern  GR_TIMER_ID     cache_timer_id;         /* cached timer ID */
@@ -44,6 +44,7 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 		return;
 
 	clipwp = wp;
+	clippp = NULL;
 
 	/*
 	 * Start with the rectangle for the complete window.
@@ -8,15 +8,15 @@
 #include "serv.h"
 
 /*
- * Set the clip rectangles for a window taking into account other
+ * Calculate the visible region of a window taking into account other
  * windows that may be obscuring it.  The windows that may be obscuring
  * this one are the siblings of each direct ancestor which are higher
  * in priority than those ancestors.  Also, each parent limits the visible
- * area of the window.  The clipping is not done if it is already up to
- * date of if the window is not outputtable.
+ * area of the window.  Returns an empty region if the window is completely
+ * clipped out of view.
  */
-void
-GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
+MWCLIPREGION *
+GsCalcVisRegion(GR_WINDOW *wp, int flags)
 {
 	GR_WINDOW	*orgwp;		/* original window pointer */
 	GR_WINDOW	*pwp;		/* parent window */
@@ -28,12 +28,7 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 	GR_COORD	diff;		/* difference in coordinates */
 	GR_SIZE		bs;		/* border size */
 	GR_COORD	x, y, width, height;
-	MWCLIPREGION	*vis, *r;
-
-	if (!wp->realized || !wp->output)
-		return;
-
-	clipwp = wp;
+	MWCLIPREGION	*vis, r;
 
 	/*
 	 * Start with the rectangle for the complete window.
@@ -76,12 +71,10 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 
 	/*
 	 * If the window is completely clipped out of view, then
-	 * set the clipping region to indicate that.
+	 * return an empty region to indicate that.
 	 */
-	if (width <= 0 || height <= 0) {
-		GdSetClipRegion(clipwp->psd, NULL);
-		return;
-	}
+	if (width <= 0 || height <= 0)
+		return GdAllocRegion();
 
 	/*
 	 * Allocate region to clipped size of window,
@@ -95,9 +88,9 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 	}
 
 	/* 
-	 * Allocate temp region
+	 * Initialize temp region
 	 */
-	r = GdAllocRegion();
+	GdInitRegion(&r);
 
 	/*
 	 * Now examine all windows that obscure this window, and
@@ -134,19 +127,21 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 			maxy = sibwp->y + sibwp->height + bs;
 
 			if (sibwp->clipregion) {
-				MWCLIPREGION *shapeR = GdAllocRegion();
-				GdSetRectRegion(shapeR, minx, miny, maxx, maxy);
+				MWCLIPREGION shapeR;
+
+				GdInitRegion(&shapeR);
+				GdSetRectRegion(&shapeR, minx, miny, maxx, maxy);
 				
 				/* FIXME: can user set invalid clipregion here? */
 				GdOffsetRegion(sibwp->clipregion, sibwp->x, sibwp->y);
-				GdIntersectRegion(shapeR, shapeR, sibwp->clipregion);
+				GdIntersectRegion(&shapeR, &shapeR, sibwp->clipregion);
 				GdOffsetRegion(sibwp->clipregion, -sibwp->x, -sibwp->y);
 				
-				GdSubtractRegion(vis, vis, shapeR);
-				GdDestroyRegion(shapeR);
+				GdSubtractRegion(vis, vis, &shapeR);
+				GdUninitRegion(&shapeR);
 			} else {
-				GdSetRectRegion(r, minx, miny, maxx, maxy);
-				GdSubtractRegion(vis, vis, r);
+				GdSetRectRegion(&r, minx, miny, maxx, maxy);
+				GdSubtractRegion(vis, vis, &r);
 			}			
 		}
 
@@ -171,8 +166,8 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 			maxx = sibwp->x + sibwp->width + bs;
 			maxy = sibwp->y + sibwp->height + bs;
 
-			GdSetRectRegion(r, minx, miny, maxx, maxy);
-			GdSubtractRegion(vis, vis, r);
+			GdSetRectRegion(&r, minx, miny, maxx, maxy);
+			GdSubtractRegion(vis, vis, &r);
 			/* FIXME: shaped windows with borders won't work */
 			if (wp->clipregion) {
 				/* FIXME: can user set invalid clipregion here? */
@@ -183,6 +178,51 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 		}
 	}
 
+	/*
+	 * Release temp region
+	 */
+	GdUninitRegion(&r);
+
+	return vis;
+}
+
+/*
+ * Set the clip rectangles for a window to its visible region, intersected
+ * with the user region if set.  The visible region is cached in the window
+ * and only recalculated when clipgeneration has changed since, that is when
+ * any window has been moved, resized, mapped, unmapped, restacked or shaped.
+ * The GS_CLIP_NOCACHE flag bypasses the cache, for callers that temporarily
+ * change window geometry.  Clipping is not done if the window is not
+ * outputtable.
+ */
+void
+GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
+{
+	MWCLIPREGION	*vis;
+
+	if (!wp->realized || !wp->output)
+		return;
+
+	clipwp = wp;
+	clippp = NULL;
+
+	if (flags & GS_CLIP_NOCACHE)
+		vis = GsCalcVisRegion(wp, flags);
+	else {
+		/* only child exclusion changes the visible region*/
+		flags &= GR_MODE_EXCLUDECHILDREN;
+		if (!wp->visregion || wp->visgeneration != clipgeneration ||
+		    wp->visflags != flags) {
+			if (wp->visregion)
+				GdDestroyRegion(wp->visregion);
+			wp->visregion = GsCalcVisRegion(wp, flags);
+			wp->visgeneration = clipgeneration;
+			wp->visflags = flags;
+		}
+		vis = GdAllocRegion();
+		GdCopyRegion(vis, wp->visregion);
+	}
+
 	/*
 	 * Intersect with user region, if set.
 	 */
@@ -197,9 +237,4 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 	 * Set the clip region (later destroy handled by GdSetClipRegion)
 	 */
 	GdSetClipRegion(clipwp->psd, vis);
-
-	/*
-	 * Destroy temp region
-	 */
-	GdDestroyRegion(r);
 }
@@ -105,6 +105,98 @@ GR_EVENT *GsAllocEvent(GR_CLIENT *client)
 	return &elp->event;
 }
 
+#define GS_EVENTBACKLOG	32	/* queued events before client is backlogged*/
+
+/*
+ * Return TRUE if a client isn't keeping up with its events, either
+ * because its socket isn't taking queued output or because many events
+ * are waiting.  Motion and exposure events are coalesced for such clients.
+ */
+static GR_BOOL
+GsClientBacklogged(GR_CLIENT *client)
+{
+	GR_EVENT_LIST	*elp;
+	int		n = 0;
+
+	if (GsOutputPending(client))
+		return GR_TRUE;
+	for (elp = client->eventhead; elp; elp = elp->next)
+		if (++n >= GS_EVENTBACKLOG)
+			return GR_TRUE;
+	return GR_FALSE;
+}
+
+/*
+ * Remove the last queued event if it is a mouse motion event for the
+ * same window and buttons, so a backlogged client gets only the
+ * latest position.  Earlier events aren't touched to keep ordering
+ * with button and keyboard events.
+ */
+static void
+GsFreeMotionEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_WINDOW_ID subwid,
+	int buttons)
+{
+	GR_EVENT_LIST	*elp;		/* current element list */
+	GR_EVENT_LIST	*prevelp;	/* previous element list */
+
+	EVENT_LOCK(&eventMutex);
+	elp = client->eventtail;
+	if (!elp || elp->event.type != GR_EVENT_TYPE_MOUSE_MOTION ||
+	    elp->event.mouse.wid != wid || elp->event.mouse.subwid != subwid ||
+	    elp->event.mouse.buttons != buttons) {
+		EVENT_UNLOCK(&eventMutex);
+		return;
+	}
+
+	prevelp = NULL;
+	if (client->eventhead != elp)
+		for (prevelp = client->eventhead; prevelp->next != elp; prevelp = prevelp->next)
+			continue;
+	if (prevelp)
+		prevelp->next = NULL;
+	else
+		client->eventhead = NULL;
+	client->eventtail = prevelp;
+
+	elp->next = eventfree;
+	eventfree = elp;
+	EVENT_UNLOCK(&eventMutex);
+}
+
+/*
+ * Merge an exposure rectangle into the last queued event if it is an
+ * exposure event for the same window, for backlogged clients.  The
+ * queued event grows to the bounding rectangle of both.  Earlier events
+ * aren't touched to keep ordering with map and configure events.
+ * Returns TRUE if merged.
+ */
+static GR_BOOL
+GsMergeExposureEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_COORD x,
+	GR_COORD y, GR_SIZE width, GR_SIZE height)
+{
+	GR_EVENT_LIST	*elp;		/* current element list */
+	GR_EVENT_EXPOSURE *ep;
+	GR_COORD	x2, y2;
+
+	EVENT_LOCK(&eventMutex);
+	elp = client->eventtail;
+	if (!elp || elp->event.type != GR_EVENT_TYPE_EXPOSURE ||
+	    elp->event.exposure.wid != wid) {
+		EVENT_UNLOCK(&eventMutex);
+		return GR_FALSE;
+	}
+
+	ep = &elp->event.exposure;
+	x2 = MWMAX(ep->x + ep->width, x + width);
+	y2 = MWMAX(ep->y + ep->height, y + height);
+	ep->x = MWMIN(ep->x, x);
+	ep->y = MWMIN(ep->y, y);
+	ep->width = x2 - ep->x;
+	ep->height = y2 - ep->y;
+	EVENT_UNLOCK(&eventMutex);
+	return GR_TRUE;
+}
+
 /*
  * Update mouse status and issue events on it if necessary.
  * This function doesn't block, but is only called when Poll() returns TRUE
@@ -424,6 +516,8 @@ void GsDeliverMotionEvent(GR_EVENT_TYPE type, int buttons, MWKEYMOD modifiers)
 			 */
 			if (type == GR_EVENT_TYPE_MOUSE_POSITION)
 				GsFreePositionEvent(client, wp->id, subwid);
+			else if (GsClientBacklogged(client))
+				GsFreeMotionEvent(client, wp->id, subwid, buttons);
 
 			ep = (GR_EVENT_MOUSE *) GsAllocEvent(client);
 			if (ep == NULL)
@@ -630,6 +724,9 @@ GsDeliverExposureEvent(GR_WINDOW *wp, GR_COORD x, GR_COORD y,
 			continue;
 
 		GsFreeExposureEvent(ecp->client, wp->id, x, y, width, height);
+		if (GsClientBacklogged(ecp->client) &&
+		    GsMergeExposureEvent(ecp->client, wp->id, x, y, width, height))
+			continue;
 
 		ep = (GR_EVENT_EXPOSURE *) GsAllocEvent(ecp->client);
 		if (ep == NULL)
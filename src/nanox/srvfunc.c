@@ -12,6 +12,9 @@
 #include "nanowm.h"
 #include "osdep.h"
 #include "../drivers/genmem.h"
+#if MW_FEATURE_SERVERSTATS && !NONETWORK
+#include "nxproto.h"
+#endif
 
 static int	nextid = GR_ROOT_WINDOW_ID + 1;
 
@@ -275,6 +278,18 @@ GrRaiseWindow(GR_WINDOW_ID wid)
 	}
 	overlap |= GsCheckOverlap(prevwp, wp);
 
+#if MW_FEATURE_BACKINGSTORE
+	/*
+	 * Save top level windows about to be covered, and visible part
+	 * of this window so that it can be entirely restored after raising.
+	 */
+	if (overlap && wp->parent == rootwp) {
+		GsBackingSaveArea(wp, wp->x - wp->bordersize, wp->y - wp->bordersize,
+			wp->width + wp->bordersize * 2, wp->height + wp->bordersize * 2);
+		GsBackingSave(wp, wp->x, wp->y, wp->width, wp->height);
+	}
+#endif
+
 	/*
 	 * Now unlink the window and relink it in at the front of the
 	 * sibling chain.
@@ -282,6 +297,7 @@ GrRaiseWindow(GR_WINDOW_ID wid)
 	prevwp->siblings = wp->siblings;
 	wp->siblings = wp->parent->children;
 	wp->parent->children = wp;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	/*
 	 * Finally redraw the window if necessary.
@@ -336,6 +352,12 @@ GrLowerWindow(GR_WINDOW_ID wid)
 	while (sibwp->siblings)
 		sibwp = sibwp->siblings;
 
+#if MW_FEATURE_BACKINGSTORE
+	/* save window about to be covered*/
+	if (wp->parent == rootwp)
+		GsBackingSave(wp, wp->x, wp->y, wp->width, wp->height);
+#endif
+
 	/*
 	 * Now unlink the window and relink it in at the end of the
 	 * sibling chain.
@@ -347,6 +369,7 @@ GrLowerWindow(GR_WINDOW_ID wid)
 	sibwp->siblings = wp;
 
 	wp->siblings = NULL;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	/*
 	 * Finally redraw the sibling windows which this window covered
@@ -371,6 +394,7 @@ OffsetWindow(GR_WINDOW *wp, GR_COORD offx, GR_COORD offy)
 {
 	GR_WINDOW	*cp;
 
+	++clipgeneration;
 	wp->x += offx;
 	wp->y += offy;
 	for(cp=wp->children; cp; cp=cp->siblings)
@@ -390,6 +414,26 @@ DeliverUpdateMoveEventAndChildren(GR_WINDOW *wp)
 		DeliverUpdateMoveEventAndChildren(childwp);
 }
 
+#if MW_FEATURE_BACKINGSTORE
+/* expose area of root uncovered by moving top level window from oldx, oldy*/
+static void
+ExposeUncoveredArea(GR_WINDOW *wp, GR_COORD oldx, GR_COORD oldy)
+{
+	GR_SIZE		bs = wp->bordersize;
+	MWCLIPREGION	*r, *n;
+	MWRECT		*rc;
+	int		i;
+
+	r = GdAllocRectRegion(oldx - bs, oldy - bs, oldx + wp->width + bs, oldy + wp->height + bs);
+	n = GdAllocRectRegion(wp->x - bs, wp->y - bs, wp->x + wp->width + bs, wp->y + wp->height + bs);
+	GdSubtractRegion(r, r, n);
+	for (i = 0, rc = r->rects; i < r->numRects; i++, rc++)
+		GsExposeArea(rootwp, rc->left, rc->top, rc->right - rc->left, rc->bottom - rc->top, wp);
+	GdDestroyRegion(n);
+	GdDestroyRegion(r);
+}
+#endif
+
 #if !(SWIEROS | ELKS)
 static int
 IsUnobscuredBySiblings(GR_WINDOW *wp)
@@ -470,6 +514,13 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 		/* turn off clipping of root's children*/
 		GrSetGCMode(gc, GR_MODE_COPY|GR_MODE_EXCLUDECHILDREN);
 
+#if MW_FEATURE_BACKINGSTORE
+		/* save top level windows about to be covered*/
+		if (parent == rootwp)
+			GsBackingSaveArea(wp, x - wp->bordersize, y - wp->bordersize,
+				wp->width + wp->bordersize * 2, wp->height + wp->bordersize * 2);
+#endif
+
 		/* calc new window offsets*/
 		OffsetWindow(wp, offx, offy);
 
@@ -492,15 +543,23 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 		    (oldy+wp->height > rootwp->height && wp->y < oldy))
 			stopwp = NULL;
 
-		/* 
-		 * Calculate bounded exposed area and
-		 * redraw anything lower than stopwp window.
-		 */
-		X = MWMIN(oldx, wp->x);
-		Y = MWMIN(oldy, wp->y);
-		W = MWMAX(oldx, wp->x) + wp->width - X;
-		H = MWMAX(oldy, wp->y) + wp->height - Y;
-		GsExposeArea(rootwp, X, Y, W, H, stopwp);
+#if MW_FEATURE_BACKINGSTORE
+		/* expose only area uncovered by move, restoring from backing store*/
+		if (stopwp && parent == rootwp)
+			ExposeUncoveredArea(wp, oldx, oldy);
+		else
+#endif
+		{
+			/* 
+			 * Calculate bounded exposed area and
+			 * redraw anything lower than stopwp window.
+			 */
+			X = MWMIN(oldx, wp->x);
+			Y = MWMIN(oldy, wp->y);
+			W = MWMAX(oldx, wp->x) + wp->width - X;
+			H = MWMAX(oldy, wp->y) + wp->height - Y;
+			GsExposeArea(rootwp, X, Y, W, H, stopwp);
+		}
 
 		GdShowCursor(rootwp->psd);
 		GrDestroyGC(gc);
@@ -670,6 +729,15 @@ GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 	if (wp->props & GR_WM_PROPS_BUFFERED)
 		GsInitWindowBuffer(wp, width, height); /* allocate buffer and fill background*/
 
+#if MW_FEATURE_BACKINGSTORE
+	/* save top level windows about to be covered, discard old size backing*/
+	if (wp->parent == rootwp && wp->realized && wp->output &&
+	    (width > wp->width || height > wp->height))
+		GsBackingSaveArea(wp, wp->x - wp->bordersize, wp->y - wp->bordersize,
+			width + wp->bordersize * 2, height + wp->bordersize * 2);
+	GsFreeBacking(wp);
+#endif
+
 	if (!wp->realized || !wp->output) {
 		wp->width = width;
 		wp->height = height;
@@ -695,6 +763,7 @@ GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 	oldh = wp->height;
 	wp->width = width;
 	wp->height = height;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	/* draw background and send expose events in resized window and all children*/
 	drawBackgroundAndExpose(wp);
@@ -755,6 +824,9 @@ GrReparentWindow(GR_WINDOW_ID wid, GR_WINDOW_ID pwid, GR_COORD x, GR_COORD y)
 	 * this window isn't already realized.
 	 */
 	GsUnrealizeWindow(wp, GR_TRUE);
+#if MW_FEATURE_BACKINGSTORE
+	GsFreeBacking(wp);		/* backing store for top level windows only*/
+#endif
 
 	/* link window into new parent chain*/
 	for(mysibptr = &(wp->parent->children); *mysibptr != wp; 
@@ -765,6 +837,7 @@ GrReparentWindow(GR_WINDOW_ID wid, GR_WINDOW_ID pwid, GR_COORD x, GR_COORD y)
 	wp->parent = pwp;
 	wp->siblings = pwp->children;
 	pwp->children = wp;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	if (offx || offy)
 		OffsetWindow(wp, offx, offy);
@@ -839,6 +912,7 @@ GrNewGC(void)
 	gcp->next = listgcp;
 
 	listgcp = gcp;
+	GsAddResource(GR_RES_GC, gcp->id, gcp);
 
 	SERVER_UNLOCK();
 
@@ -869,6 +943,7 @@ GrDestroyGC(GR_GC_ID gc)
 	if (gcp == curgcp)
 		curgcp = NULL;
 
+	GsRemoveResource(GR_RES_GC, gcp->id);
 	if (listgcp == gcp)
 		listgcp = gcp->next;
 	else {
@@ -923,6 +998,7 @@ GrCopyGC(GR_GC_ID gc)
 	gcp->owner = curclient;
 	gcp->next = listgcp;
 	listgcp = gcp;
+	GsAddResource(GR_RES_GC, gcp->id, gcp);
 
 	SERVER_UNLOCK();
 
@@ -995,6 +1071,7 @@ GrNewRegion(void)
 	regionp->next = listregionp;
 
 	listregionp = regionp;
+	GsAddResource(GR_RES_REGION, regionp->id, regionp);
 
 	id = regionp->id;
 
@@ -1029,6 +1106,7 @@ GrNewPolygonRegion(int mode, GR_COUNT count, GR_POINT *points)
 	regionp->next = listregionp;
 
 	listregionp = regionp;
+	GsAddResource(GR_RES_REGION, regionp->id, regionp);
 
 	id = regionp->id;
 
@@ -1055,6 +1133,7 @@ GrDestroyRegion(GR_REGION_ID region)
 		return;
 	}
 
+	GsRemoveResource(GR_RES_REGION, regionp->id);
 	if (listregionp == regionp) {
 		listregionp = regionp->next;
 	} else {
@@ -1469,6 +1548,7 @@ GrCreateFontEx(const char *name, GR_COORD height, GR_COORD width, GR_LOGFONT *pl
 	fontp->next = listfontp;
 
 	listfontp = fontp;
+	GsAddResource(GR_RES_FONT, fontp->id, fontp);
 
 	SERVER_UNLOCK();
 	
@@ -1512,6 +1592,7 @@ GrCreateFontFromBuffer(const void *buffer, unsigned length, const char *format,
 	fontp->owner = curclient;
 	fontp->next = listfontp;
 	listfontp = fontp;
+	GsAddResource(GR_RES_FONT, fontp->id, fontp);
 
 	SERVER_UNLOCK();
 	return fontp->id;
@@ -1546,6 +1627,7 @@ GrCopyFont(GR_FONT_ID fontid, GR_COORD height, GR_COORD width)
 	fontp->owner = curclient;
 	fontp->next = listfontp;
 	listfontp = fontp;
+	GsAddResource(GR_RES_FONT, fontp->id, fontp);
 	
 	SERVER_UNLOCK();
 	return fontp->id;
@@ -1614,6 +1696,7 @@ GrDestroyFont(GR_FONT_ID fontid)
 		return;
 	}
 
+	GsRemoveResource(GR_RES_FONT, fontp->id);
 	if (listfontp == fontp)
 		listfontp = fontp->next;
 	else {
@@ -1790,9 +1873,17 @@ NewWindow(GR_WINDOW *pwp, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height,
 	wp->title = NULL;
 	wp->clipregion = NULL;
 	wp->buffer = NULL;
+	wp->visregion = NULL;
+#if MW_FEATURE_BACKINGSTORE
+	wp->backing = NULL;
+	wp->backvalid = NULL;
+	wp->backnext = NULL;
+	wp->backprev = NULL;
+#endif
 
 	pwp->children = wp;
 	listwp = wp;
+	GsAddResource(GR_RES_WINDOW, wp->id, wp);
 
 	return wp;
 }
@@ -1883,6 +1974,34 @@ GrNewPixmapEx(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 	return id;
 }
 
+/*
+ * Allocate a pixmap whose pixels are directly writable by the application.
+ * When linked with the server, this is the pixmap memory itself.
+ */
+GR_WINDOW_ID
+GrNewSharedPixmap(GR_SIZE width, GR_SIZE height, int format, void **pixels, int *pitch)
+{
+	GR_WINDOW_ID id;
+	GR_PIXMAP	*pp;
+
+	SERVER_LOCK();
+	id = GsNewPixmap(width, height, format, NULL);
+	if ((pp = GsFindPixmap(id)) != NULL) {
+		*pixels = pp->psd->addr;
+		*pitch = pp->psd->pitch;
+	}
+	SERVER_UNLOCK();
+
+	return id;
+}
+
+/* destroy pixmap created by GrNewSharedPixmap*/
+void
+GrDestroySharedPixmap(GR_WINDOW_ID pid, void *pixels)
+{
+	GrDestroyWindow(pid);
+}
+
 GR_WINDOW_ID
 GsNewPixmap(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 {
@@ -1913,8 +2032,10 @@ GsNewPixmap(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 	pp->width = width;
 	pp->height = height;
 	pp->owner = curclient;
+	pp->shmid = -1;
 	pp->next = listpp;
 	listpp = pp;
+	GsAddResource(GR_RES_PIXMAP, pp->id, pp);
 
 	return pp->id;
 }
@@ -2086,6 +2207,7 @@ GrNewCursor(GR_SIZE width, GR_SIZE height, GR_COORD hotx, GR_COORD hoty,
 	cp->owner = curclient;
 	cp->next = listcursorp;
 	listcursorp = cp;
+	GsAddResource(GR_RES_CURSOR, cp->id, cp);
 
 	id = cp->id;
 	
@@ -2111,6 +2233,7 @@ GrDestroyCursor(GR_CURSOR_ID cid)
 		return;
 	}
 
+	GsRemoveResource(GR_RES_CURSOR, cursorp->id);
 	if (listcursorp == cursorp)
 		listcursorp = cursorp->next;
 	else {
@@ -2611,6 +2734,32 @@ GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Draw count separate lines in the specified drawable using the specified
+ * graphics context.  The point table holds two end points for each line.
+ */
+void
+GrLines(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
+{
+	GR_DRAWABLE	*dp;
+	GR_POINT	*pp;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		pp = pointtable;
+		for (i = count; i-- > 0; pp += 2)
+			GdLine(dp->psd, dp->x + pp[0].x, dp->y + pp[0].y,
+				dp->x + pp[1].x, dp->y + pp[1].y, TRUE);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Draw the boundary of a rectangle in the specified drawable using the
  * specified graphics context.
@@ -2657,6 +2806,32 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Fill an array of rectangles in the specified drawable using the
+ * specified graphics context.  The drawable and gc are prepared once
+ * for all rectangles.
+ */
+void
+GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	GR_DRAWABLE	*dp;
+	GR_RECT		*rp;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		rp = recttable;
+		for (i = count; i-- > 0; rp++)
+			GdFillRect(dp->psd, dp->x + rp->x, dp->y + rp->y, rp->width, rp->height);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Draw the boundary of an ellipse in the specified drawable with
  * the specified graphics context.  Integer only.
@@ -2847,6 +3022,7 @@ GrLoadImageFromFile(char *path, int flags)
 	pp->owner = curclient;
 	pp->next = listpp;
 	listpp = pp;
+	GsAddResource(GR_RES_PIXMAP, pp->id, pp);
 
 	SERVER_UNLOCK();
 	return pp->id;
@@ -2906,6 +3082,7 @@ GrLoadImageFromBuffer(void *buffer, int size, int flags)
 	pp->owner = curclient;
 	pp->next = listpp;
 	listpp = pp;
+	GsAddResource(GR_RES_PIXMAP, pp->id, pp);
 
 	SERVER_UNLOCK();
 	return pp->id;
@@ -3331,6 +3508,49 @@ GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, void *str,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Draw an array of text strings in the specified drawable using the
+ * specified graphics context and flags.  The drawable, gc and font
+ * are looked up once for all strings.
+ */
+void
+GrTexts(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_TEXTITEM *items,
+	GR_TEXTFLAGS flags)
+{
+	GR_DRAWABLE	*dp;
+	GR_GC		*gcp;
+	GR_FONT		*fontp;
+	PMWFONT		pf;
+	GR_TEXTITEM	*ip;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	/* default to baseline alignment if none specified*/
+	if((flags&(MWTF_TOP|MWTF_BASELINE|MWTF_BOTTOM)) == 0)
+		flags |= MWTF_BASELINE;
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		gcp = GsFindGC(gc);
+		fontp = gcp? GsFindFont(gcp->fontid): NULL;
+		pf = fontp? fontp->pfont: stdfont;
+		ip = items;
+		for (i = count; i-- > 0; ip++) {
+			int cc = ip->count;
+
+			/* use strlen as char count when ascii, for NONETWORK callers*/
+			if (cc == -1 && (flags&MWTF_PACKMASK) == MWTF_ASCII)
+				cc = strlen((char *)ip->str);
+			GdText(dp->psd, pf, dp->x + ip->x, dp->y + ip->y, ip->str, cc, flags);
+		}
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 /* Return the system palette entries*/
 void
 GrGetSystemPalette(GR_PALETTE *pal)
@@ -3602,6 +3822,46 @@ GrGetSysColor(int index)
 	return color;
 }
 
+/*
+ * Return request statistics for client with process id pid, or all clients
+ * if pid is 0.  Returns FALSE if statistics not compiled in or no such client.
+ * Statistics are kept by the network request dispatcher, so applications
+ * linked into the server (NONETWORK) always get FALSE.
+ */
+GR_BOOL
+GrGetServerStats(int pid, GR_SERVER_STATS *sp)
+{
+#if MW_FEATURE_SERVERSTATS && !NONETWORK
+	GR_CLIENT *client;
+	GR_REQUEST_STATS *stats = GsServerStats;
+	int n = GrTotalNumCalls;
+
+	SERVER_LOCK();
+	if (pid) {
+		for (client = root_client; client; client = client->next)
+			if (client->processid == pid)
+				break;
+		if (!client) {
+			SERVER_UNLOCK();
+			return GR_FALSE;
+		}
+		stats = client->stats;
+	}
+
+	memset(sp, 0, sizeof(*sp));
+	if (n > GR_STATS_MAXREQ)
+		n = GR_STATS_MAXREQ;
+	sp->numreqs = n;
+	sp->nclients = connectcount;
+	if (stats)
+		memcpy(sp->reqs, stats, n * sizeof(GR_REQUEST_STATS));
+	SERVER_UNLOCK();
+	return GR_TRUE;
+#else
+	return GR_FALSE;
+#endif
+}
+
 void
 GrSetScreenSaverTimeout(GR_TIMEOUT timeout)
 {
@@ -4042,6 +4302,7 @@ GrNewBitmapRegion(GR_BITMAP *bitmap, GR_SIZE width, GR_SIZE height)
 	regionp->next = listregionp;
 
 	listregionp = regionp;
+	GsAddResource(GR_RES_REGION, regionp->id, regionp);
 	id = regionp->id;
 	
 	SERVER_UNLOCK();
@@ -4106,6 +4367,7 @@ GrSetWindowRegion(GR_WINDOW_ID wid, GR_REGION_ID rid, int type)
 	if (wp->clipregion)
 		GdDestroyRegion(wp->clipregion);
 	wp->clipregion = newregion;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	SERVER_UNLOCK();
 #endif
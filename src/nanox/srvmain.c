@@ -40,6 +40,8 @@ GR_CURSOR	*listcursorp;		/* list of all cursors */
 GR_CURSOR	*stdcursor;		/* root window cursor */
 GR_GC		*curgcp;		/* currently enabled gc */
 GR_WINDOW	*clipwp;		/* window clipping is set for */
+GR_PIXMAP	*clippp;		/* pixmap clipping is set for */
+unsigned long	clipgeneration;		/* incremented on window stacking/geometry change*/
 GR_WINDOW	*focuswp;		/* focus window for keyboard */
 GR_WINDOW	*mousewp;		/* window mouse is currently in */
 GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -92,6 +94,16 @@ static int	Argc;
 static char **	Argv;
 int		un_sock;		/* the server socket descriptor */
 
+#if MW_FEATURE_SERVERSTATS && HAVE_SIGNAL
+static volatile sig_atomic_t dumpstats;	/* SIGUSR1 received, print statistics*/
+
+static void
+GsStatsSignal(int sig)
+{
+	dumpstats = 1;
+}
+#endif
+
 static void
 usage(void)
 {
@@ -165,6 +177,15 @@ MAIN(int argc, char **argv)			/* ALLEGRO=real_main(), main() otherwise*/
 			++t;
 			continue;
 		}
+#if MW_FEATURE_BACKINGSTORE
+		if ( !strcmp("-B",argv[t]) ) {
+			if (++t >= argc)
+				usage();
+			backingmax = atol(argv[t]) * 1024;
+			++t;
+			continue;
+		}
+#endif
 #if FONTMAPPER
 		if ( !strcmp("-c",argv[t]) ) {
 			int read_configfile(char *file);
@@ -188,8 +209,15 @@ MAIN(int argc, char **argv)			/* ALLEGRO=real_main(), main() otherwise*/
 	if(GsInitialize() < 0)
 		exit(1);
 
-	while(1)
+	while(1) {
 		GsSelect(GR_TIMEOUT_BLOCK);
+#if MW_FEATURE_SERVERSTATS && HAVE_SIGNAL
+		if (dumpstats) {
+			dumpstats = 0;
+			GsDumpServerStats();
+		}
+#endif
+	}
 	return 0;
 }
 #endif /* !NONETWORK*/
@@ -214,6 +242,17 @@ GsAcceptClientFd(int i)
 	client->prev = NULL;
 	client->waiting_for_event = FALSE;
 	client->shm_cmds = 0;
+	client->processid = 0;
+	client->inbuf = NULL;
+	client->instart = 0;
+	client->inend = 0;
+	client->outbuf = NULL;
+	client->outstart = 0;
+	client->outend = 0;
+	client->outsize = 0;
+#if MW_FEATURE_SERVERSTATS
+	client->stats = NULL;
+#endif
 
 	if(connectcount++ == 0)
 		root_client = client;
@@ -224,6 +263,9 @@ GsAcceptClientFd(int i)
 		client->prev = cl;
 		cl->next = client;
 	}
+#if HAVE_EPOLL && !NONETWORK
+	GsEpollAdd(i);
+#endif
 }
 
 /*
@@ -305,6 +347,9 @@ GrRegisterInput(int fd)
 	SERVER_LOCK();
 	FD_SET(fd, &regfdset);
 	if (fd >= regfdmax) regfdmax = fd + 1;
+#if HAVE_EPOLL
+	GsEpollAdd(fd);
+#endif
 	SERVER_UNLOCK();
 }
 
@@ -316,6 +361,11 @@ GrUnregisterInput(int fd)
 	SERVER_LOCK();
 	/* unregister all inputs if the FD is -1 */
 	if (fd == -1) {
+#if HAVE_EPOLL
+		for (i = 0; i < regfdmax; i++)
+			if (FD_ISSET(i, &regfdset))
+				GsEpollDel(i);
+#endif
 		FD_ZERO(&regfdset);
 		regfdmax = -1;
 		SERVER_UNLOCK();
@@ -323,6 +373,9 @@ GrUnregisterInput(int fd)
 	}
 
 	FD_CLR(fd, &regfdset);
+#if HAVE_EPOLL
+	GsEpollDel(fd);
+#endif
 	/* recalculate the max file descriptor */
 	for (i = 0, max = regfdmax, regfdmax = -1; i < max; i++)
 		if (FD_ISSET(i, &regfdset))
@@ -361,17 +414,200 @@ GsPumpEvents(void)
 }
 #endif
 
+#if HAVE_EPOLL
+/*
+ * Linux epoll backend for GsSelect.  File descriptors are registered
+ * once when opened and removed when closed, rather than rebuilding
+ * an fd_set from the client list each pass, which also removes the
+ * FD_SETSIZE limit on client connections.  If epoll can't be created
+ * or refuses a descriptor (e.g. a regular file), GsSelect falls back
+ * to select() permanently.
+ */
+#include <sys/epoll.h>
+
+#define GS_EPOLL_MAXEVENTS	64		/* max ready fds serviced per wakeup*/
+
+static int	epoll_fd = -1;		/* epoll instance, -1 if not yet created*/
+static int	epoll_failed;		/* =1 epoll unusable, use select()*/
+
+static void
+GsEpollFail(void)
+{
+	EPRINTF("nano-X: epoll failed (%d), using select\n", errno);
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+	epoll_fd = -1;
+	epoll_failed = 1;
+}
+
+/* add a file descriptor to the epoll read set*/
+void
+GsEpollAdd(int fd)
+{
+	struct epoll_event ev;
+
+	if (epoll_fd < 0 || fd < 0)
+		return;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST)
+		GsEpollFail();
+}
+
+/* remove a file descriptor from the epoll read set, must be called before close*/
+void
+GsEpollDel(int fd)
+{
+	struct epoll_event ev;		/* non-NULL for kernels before 2.6.9*/
+
+	if (epoll_fd < 0 || fd < 0)
+		return;
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+/* wait for output space rather than input on a client with queued output*/
+void
+GsEpollOutput(int fd, GR_BOOL output)
+{
+	struct epoll_event ev;
+
+	if (epoll_fd < 0 || fd < 0)
+		return;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = output? EPOLLOUT: EPOLLIN;
+	ev.data.fd = fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+/*
+ * Create the epoll instance on first use and register all
+ * currently open input descriptors.  Returns -1 if select should be used.
+ */
+static int
+GsEpollInit(void)
+{
+#if NONETWORK
+	int fd;
+#else
+	GR_CLIENT *client;
+#endif
+
+	if (epoll_fd >= 0)
+		return 0;
+	if (epoll_failed)
+		return -1;
+
+	if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		GsEpollFail();
+		return -1;
+	}
+	GsEpollAdd(mouse_fd);
+	GsEpollAdd(keyb_fd);
+#if NONETWORK
+	for (fd = 0; fd < regfdmax; fd++)
+		if (FD_ISSET(fd, &regfdset))
+			GsEpollAdd(fd);
+#else
+	GsEpollAdd(un_sock);
+	for (client = root_client; client; client = client->next)
+		GsEpollAdd(client->id);
+#endif
+	return epoll_failed? -1: 0;
+}
+
+/* wait for input on registered fds, returns epoll_wait result*/
+static int
+GsEpollWait(struct epoll_event *events, struct timeval *to)
+{
+	int	msecs = -1;
+
+	if (to)		/* round up to msecs so timers aren't serviced early*/
+		msecs = to->tv_sec * 1000 + (to->tv_usec + 999) / 1000;
+
+	return epoll_wait(epoll_fd, events, GS_EPOLL_MAXEVENTS, msecs);
+}
+
+/* service the ready fds returned from GsEpollWait*/
+static void
+GsEpollService(struct epoll_event *events, int count)
+{
+	int	i, fd;
+#if !NONETWORK
+	int	newclient = FALSE;
+#endif
+
+	for (i = 0; i < count; i++)
+	{
+		fd = events[i].data.fd;
+
+		/* service mouse file descriptor*/
+		if (fd == mouse_fd)
+		{
+			while(GsCheckMouseEvent())
+				continue;
+			continue;
+		}
+
+		/* service keyboard file descriptor*/
+		if (fd == keyb_fd)
+		{
+			while(GsCheckKeyboardEvent())
+				continue;
+			continue;
+		}
+
+#if NONETWORK
+		/* check for input on registered file descriptors */
+		if (fd < regfdmax && FD_ISSET(fd, &regfdset))
+		{
+			GR_EVENT_FDINPUT *	gp;
+
+			gp = (GR_EVENT_FDINPUT *)GsAllocEvent(curclient);
+			if(gp)
+			{
+				gp->type = GR_EVENT_TYPE_FDINPUT;
+				gp->fd = fd;
+			}
+		}
+#else
+		/* accept new clients after servicing others so a dropped fd isn't reused this pass*/
+		if (fd == un_sock)
+			newclient = TRUE;
+		else if ((curclient = GsFindClient(fd)) != NULL) {	/* may have been dropped this pass*/
+			if (GsOutputPending(curclient))
+				GsFlushClient(curclient);
+			else
+				GsHandleClient(fd);
+		}
+#endif
+	}
+
+#if !NONETWORK
+	/* If a client is trying to connect, accept it: */
+	if (newclient)
+		GsAcceptClient();
+#endif
+}
+#endif /* HAVE_EPOLL*/
+
 void
 GsSelect(GR_TIMEOUT timeout)
 {
 	fd_set	rfds;
+	fd_set	wfds;			/* clients with queued output*/
 	int 	e;
-	int	setsize = 0;
+	int	setsize;
+	int	poll;
 	struct timeval tout;
 	struct timeval *to;
 #if NONETWORK
 	int	fd;
 #endif
+#if HAVE_EPOLL
+	int	useepoll;
+	struct epoll_event events[GS_EPOLL_MAXEVENTS];
+#endif
 
 #if CONFIG_ARCH_PC98
 	if (GsCheckMouseEvent())
@@ -410,47 +646,20 @@ GsSelect(GR_TIMEOUT timeout)
 		}
 	}
 
-	/* Set up the FDs for use in the main select(): */
-	FD_ZERO(&rfds);
-	if(mouse_fd >= 0)
-	{
-		FD_SET(mouse_fd, &rfds);
-		if (mouse_fd > setsize)
-			setsize = mouse_fd;
-	}
-	if(keyb_fd >= 0)
-	{
-		FD_SET(keyb_fd, &rfds);
-		if (keyb_fd > setsize)
-			setsize = keyb_fd;
-	}
-#if NONETWORK
-	/* handle registered input file descriptors*/
-	for (fd = 0; fd < regfdmax; fd++)
-	{
-		if (!FD_ISSET(fd, &regfdset))
-			continue;
-		FD_SET(fd, &rfds);
-		if (fd > setsize) setsize = fd;
-	}
-#else /* !NONETWORK */
-	/* handle client socket connections*/
-	FD_SET(un_sock, &rfds);
-	if (un_sock > setsize) setsize = un_sock;
-	curclient = root_client;
-	while(curclient)
+#if !NONETWORK
+	/* finish any client blocked in GrGetNextEvent that now has an event*/
+	for (curclient = root_client; curclient; curclient = curclient->next)
 	{
-		if(curclient->waiting_for_event && curclient->eventhead)
+		/* events stay queued for coalescing until previous output is taken*/
+		if(curclient->waiting_for_event && curclient->eventhead &&
+		   !GsOutputPending(curclient))
 		{
 			curclient->waiting_for_event = FALSE;
 			GrGetNextEventWrapperFinish(curclient->id);
 			return;
 		}
-		FD_SET(curclient->id, &rfds);
-		if(curclient->id > setsize) setsize = curclient->id;
-		curclient = curclient->next;
 	}
-#endif /* NONETWORK */
+#endif
 
 #if CONFIG_ARCH_PC98
 	if (timeout == GR_TIMEOUT_BLOCK)
@@ -459,7 +668,7 @@ GsSelect(GR_TIMEOUT timeout)
 	/* setup timeval struct for block or poll in select()*/
 	tout.tv_sec = tout.tv_usec = 0;			/* setup for assumed poll*/
 	to = &tout;
-	int poll = (timeout == GR_TIMEOUT_POLL);
+	poll = (timeout == GR_TIMEOUT_POLL);
 	if (!poll)
 	{
 #if MW_FEATURE_TIMERS
@@ -493,14 +702,70 @@ GsSelect(GR_TIMEOUT timeout)
 		}
 	}
 
+#if HAVE_EPOLL
+	useepoll = (GsEpollInit() >= 0);
+#endif
+
 	/* Wait for some input on any of the fds in the set or a timeout*/
 #if NONETWORK
 again:
 	SERVER_UNLOCK();	        /* allow other threads to run*/
 #endif
-	e = select(setsize+1, &rfds, NULL, NULL, to);
+#if HAVE_EPOLL
+	if (useepoll)
+		e = GsEpollWait(events, to);
+	else
+#endif
+	{
+		/* Set up the FDs for use in the main select(): */
+		FD_ZERO(&rfds);
+		FD_ZERO(&wfds);
+		setsize = 0;
+		if(mouse_fd >= 0)
+		{
+			FD_SET(mouse_fd, &rfds);
+			if (mouse_fd > setsize)
+				setsize = mouse_fd;
+		}
+		if(keyb_fd >= 0)
+		{
+			FD_SET(keyb_fd, &rfds);
+			if (keyb_fd > setsize)
+				setsize = keyb_fd;
+		}
+#if NONETWORK
+		/* handle registered input file descriptors*/
+		for (fd = 0; fd < regfdmax; fd++)
+		{
+			if (!FD_ISSET(fd, &regfdset))
+				continue;
+			FD_SET(fd, &rfds);
+			if (fd > setsize) setsize = fd;
+		}
+#else /* !NONETWORK */
+		/* handle client socket connections*/
+		FD_SET(un_sock, &rfds);
+		if (un_sock > setsize) setsize = un_sock;
+		for (curclient = root_client; curclient; curclient = curclient->next)
+		{
+			/* don't read requests until queued output is taken*/
+			if (GsOutputPending(curclient))
+				FD_SET(curclient->id, &wfds);
+			else
+				FD_SET(curclient->id, &rfds);
+			if(curclient->id > setsize) setsize = curclient->id;
+		}
+#endif /* NONETWORK */
+
+		e = select(setsize+1, &rfds, &wfds, NULL, to);
+	}
 #if NONETWORK
 	SERVER_LOCK();
+#endif
+#if HAVE_EPOLL
+	if (useepoll && e > 0)		/* input ready on epoll fds*/
+		GsEpollService(events, e);
+	else
 #endif
 	if(e > 0)			/* input ready*/
 	{
@@ -543,7 +808,9 @@ again:
 
 			/* curclient may be freed in GsDropClient*/
 			curclient_next = curclient->next;
-			if(FD_ISSET(curclient->id, &rfds))
+			if(FD_ISSET(curclient->id, &wfds))
+				GsFlushClient(curclient);
+			else if(FD_ISSET(curclient->id, &rfds))
 				GsHandleClient(curclient->id);
 			curclient = curclient_next;
 		}
@@ -958,6 +1225,10 @@ GsInitialize(void)
 	/* ignore pipe signal, sent when clients exit*/
 	signal(SIGPIPE, SIG_IGN);
 	signal(SIGHUP, SIG_IGN);
+#if MW_FEATURE_SERVERSTATS
+	/* print request statistics on SIGUSR1*/
+	signal(SIGUSR1, GsStatsSignal);
+#endif
 #endif
 
 	if (GsOpenSocket() < 0) {
@@ -1031,6 +1302,13 @@ GsInitialize(void)
 	wp->title = NULL;
 	wp->clipregion = NULL;
 	wp->buffer = NULL;
+	wp->visregion = NULL;
+#if MW_FEATURE_BACKINGSTORE
+	wp->backing = NULL;
+	wp->backvalid = NULL;
+	wp->backnext = NULL;
+	wp->backprev = NULL;
+#endif
 
 	listpp = NULL;
 	listwp = wp;
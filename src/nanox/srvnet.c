@@ -16,6 +16,8 @@
 #include "uni_std.h"
 #include <errno.h>
 #include <string.h>
+#include <time.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #if HAVE_SHAREDMEM_SUPPORT
 #include <sys/types.h>
@@ -115,6 +117,54 @@ GrNewPixmapExWrapper(void *r)
 	GsWrite(current_fd, &wid, sizeof(wid));
 }
 
+/*
+ * Create a pixmap whose pixels are in a shared memory segment
+ * the client attaches to and writes directly.
+ */
+static void
+GrNewSharedPixmapWrapper(void *r)
+{
+	nxNewSharedPixmapReq *req = r;
+	nxNewSharedPixmapReply reply;
+#if HAVE_SHAREDMEM_SUPPORT
+	GR_PIXMAP	*pp;
+	PSD		psd;
+	void		*addr;
+	int		shmid;
+#endif
+
+	memset(&reply, 0, sizeof(reply));
+#if HAVE_SHAREDMEM_SUPPORT
+	reply.wid = GsNewPixmap(req->width, req->height, req->format, NULL);
+	if ((pp = GsFindPixmap(reply.wid)) != NULL) {
+		psd = pp->psd;
+
+		/* replace malloc'd pixels with zeroed shared memory segment*/
+		shmid = shmget(IPC_PRIVATE, psd->size, IPC_CREAT|0666);
+		if (shmid != -1 && (addr = shmat(shmid, 0, 0)) != (void *)-1) {
+			free(psd->addr);
+			psd->addr = addr;
+			psd->flags &= ~PSF_ADDRMALLOC;
+			psd->flags |= PSF_ADDRSHMEM;
+			pp->shmid = shmid;
+
+			reply.shmid = shmid;
+			reply.pitch = psd->pitch;
+			reply.size = psd->size;
+		} else {
+			EPRINTF("nano-X: Can't create shared pixmap (%d)\n", errno);
+			if (shmid != -1)
+				shmctl(shmid, IPC_RMID, NULL);
+			GsDestroyPixmap(pp);
+			reply.wid = 0;
+		}
+	}
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+
+	GsWriteType(current_fd,GrNumNewSharedPixmap);
+	GsWrite(current_fd, &reply, sizeof(reply));
+}
+
 static void
 GrNewInputWindowWrapper(void *r)
 {
@@ -593,6 +643,16 @@ GrLineWrapper(void *r)
 	GrLine(req->drawid, req->gcid, req->x1, req->y1, req->x2, req->y2);
 }
 
+static void
+GrLinesWrapper(void *r)
+{
+	nxLinesReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / (2 * sizeof(GR_POINT));
+	GrLines(req->drawid, req->gcid, count, (GR_POINT *)GetReqData(req));
+}
+
 static void
 GrPointWrapper(void *r)
 {
@@ -629,6 +689,16 @@ GrFillRectWrapper(void *r)
 		req->height);
 }
 
+static void
+GrFillRectsWrapper(void *r)
+{
+	nxFillRectsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_RECT);
+	GrFillRects(req->drawid, req->gcid, count, (GR_RECT *)GetReqData(req));
+}
+
 static void
 GrPolyWrapper(void *r)
 {
@@ -979,6 +1049,63 @@ GrTextWrapper(void *r)
 		req->count, req->flags);
 }
 
+static void
+GrTextsWrapper(void *r)
+{
+	nxTextsReq *req = r;
+	nxTextItem *tp;
+	char *		data = GetReqData(req);
+	char *		end = data + GetReqVarLen(req);
+	GR_TEXTITEM	items[32];
+	int		n = 0;
+	int		charsize;
+
+	/* bytes per char, as in nxCalcStringBytes*/
+	if (req->flags & (MWTF_UC16|MWTF_XCHAR2B))
+		charsize = 2;
+	else if (req->flags & MWTF_UC32)
+		charsize = 4;
+	else
+		charsize = 1;
+
+	/* unpack items into batches, checking each lies within the request*/
+	while (data + sizeof(nxTextItem) <= end) {
+		tp = (nxTextItem *)data;
+		data += sizeof(nxTextItem);
+		if (data + tp->size > end)
+			break;
+		items[n].x = tp->x;
+		items[n].y = tp->y;
+		items[n].str = data;
+		items[n].count = tp->count;
+		data += (tp->size + (ALIGNSZ-1)) & ~(ALIGNSZ-1);
+
+		/* skip items whose text would be read past their data*/
+		if (tp->count < 0 || tp->count * charsize > tp->size)
+			continue;
+		if (++n == 32) {
+			GrTexts(req->drawid, req->gcid, n, items, req->flags);
+			n = 0;
+		}
+	}
+	if (n)
+		GrTexts(req->drawid, req->gcid, n, items, req->flags);
+}
+
+static void
+GrGetServerStatsWrapper(void *r)
+{
+	nxGetServerStatsReq *req = r;
+	static GR_SERVER_STATS stats;
+	GR_BOOL ret;
+
+	ret = GrGetServerStats(req->pid, &stats);
+	GsWriteType(current_fd, GrNumGetServerStats);
+	GsWrite(current_fd, &ret, sizeof(ret));
+	if (ret)
+		GsWrite(current_fd, &stats, sizeof(stats));
+}
+
 static void
 GrNewCursorWrapper(void *r)
 {
@@ -1800,8 +1927,90 @@ static const struct GrFunction GrFunctions[] = {
 	/* 123 */ {GrCreateFontFromBufferWrapper, "GrCreateFontFromBuffer"},
 	/* 124 */ {GrCopyFontWrapper, "GrCopyFont"},
 	/* 125 */ {GrDrawImagePartToFitWrapper, "GrDrawImagePartToFit"},
+	/* 126 */ {GrNewSharedPixmapWrapper, "GrNewSharedPixmap"},
+	/* 127 */ {GrFillRectsWrapper, "GrFillRects"},
+	/* 128 */ {GrLinesWrapper, "GrLines"},
+	/* 129 */ {GrTextsWrapper, "GrTexts"},
+	/* 130 */ {GrGetServerStatsWrapper, "GrGetServerStats"},
 };
 
+#if MW_FEATURE_SERVERSTATS
+GR_REQUEST_STATS GsServerStats[GrTotalNumCalls];	/* all client statistics*/
+
+static double
+GsStatsTime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Call request handler, adding its count, size and time to the server
+ * and current client statistics.
+ */
+static void
+GsDispatchRequest(nxReq *req, long len)
+{
+	GR_CLIENT *client = curclient;
+	GR_REQUEST_STATS *sp;
+	double t;
+
+	t = GsStatsTime();
+	GrFunctions[req->reqType].func(req);
+	t = GsStatsTime() - t;
+
+	sp = &GsServerStats[req->reqType];
+	sp->count++;
+	sp->bytes += len;
+	sp->time += t;
+
+	/* skip client stats if request dropped the client*/
+	if (!client || curclient != client)
+		return;
+	if (!client->stats)
+		client->stats = calloc(GrTotalNumCalls, sizeof(GR_REQUEST_STATS));
+	if (client->stats) {
+		sp = &client->stats[req->reqType];
+		sp->count++;
+		sp->bytes += len;
+		sp->time += t;
+	}
+}
+
+static void
+GsPrintStats(GR_REQUEST_STATS *stats)
+{
+	int i;
+
+	EPRINTF("%-28s %10s %12s %12s\n", "request", "count", "bytes", "msecs");
+	for (i = 0; i < GrTotalNumCalls; i++) {
+		if (stats[i].count)
+			EPRINTF("%-28s %10lu %12lu %12.3f\n", GrFunctions[i].name,
+				stats[i].count, stats[i].bytes, stats[i].time * 1000);
+	}
+}
+
+/*
+ * Print server and per-client request statistics, called on SIGUSR1.
+ */
+void
+GsDumpServerStats(void)
+{
+	GR_CLIENT *client;
+
+	EPRINTF("nano-X: request statistics, %d clients\n", connectcount);
+	GsPrintStats(GsServerStats);
+	for (client = root_client; client; client = client->next) {
+		if (!client->stats)
+			continue;
+		EPRINTF("nano-X: client %d pid %d\n", client->id, client->processid);
+		GsPrintStats(client->stats);
+	}
+}
+#endif /* MW_FEATURE_SERVERSTATS*/
+
 void
 GrShmCmdsFlushWrapper(void *r)
 {
@@ -1829,7 +2038,11 @@ GrShmCmdsFlushWrapper(void *r)
 		pr = (nxReq *)do_req;
 		length = GetReqAlignedLen(pr);
 		if ( pr->reqType < GrTotalNumCalls ) {
+#if MW_FEATURE_SERVERSTATS
+			GsDispatchRequest(pr, length);
+#else
 			GrFunctions[pr->reqType].func(pr);
+#endif
 		} else {
 			EPRINTF("nano-X: Error bad shm function!\n");
 		}
@@ -1924,6 +2137,9 @@ GsAcceptClient(void)
 		EPRINTF("nano-X: Error accept failed (%d)\n", errno);
 		return;
 	}
+
+	/* replies and events are queued rather than blocking on a slow client*/
+	fcntl(i, F_SETFL, fcntl(i, F_GETFL) | O_NONBLOCK);
 	GsAcceptClientFd(i);
 }
 
@@ -2145,6 +2361,9 @@ GsDropClient(int fd)
 	GR_CLIENT *client;
 
 	if((client = GsFindClient(fd))) { /* If it exists */
+#if HAVE_EPOLL
+		GsEpollDel(fd);
+#endif
 		close(fd);	/* Close the socket */
 
 		GsDestroyClientResources(client);
@@ -2164,6 +2383,11 @@ GsDropClient(int fd)
 		}
 #endif
 		GsPrintResources();
+#if MW_FEATURE_SERVERSTATS
+		free(client->stats);
+#endif
+		free(client->inbuf);
+		free(client->outbuf);
 
 		if (curclient == client)
 			curclient = root_client;
@@ -2201,25 +2425,117 @@ GsRead(int fd, void *buf, int c)
 }
 
 /*
- * This is a wrapper to write().
+ * Queue output that a client's socket won't take now, to be sent
+ * by GsFlushClient when the socket is writable.  The client is
+ * dropped if its queue grows past MW_CLIENT_OUTMAXKB.
+ */
+static int
+GsQueueOutput(GR_CLIENT *client, char *buf, int c)
+{
+	int	len = client->outend - client->outstart;
+	int	size;
+	char *	p;
+
+	if ((long)len + c > MW_CLIENT_OUTMAXKB * 1024L) {
+		EPRINTF("nano-X: client %d output queue full, dropping\n", client->id);
+		GsClose(client->id);
+		return -1;
+	}
+
+	if (client->outend + c > client->outsize) {
+		/* move pending output to start of queue, then grow if needed*/
+		if (client->outstart) {
+			memmove(client->outbuf, client->outbuf + client->outstart, len);
+			client->outstart = 0;
+			client->outend = len;
+		}
+		if (len + c > client->outsize) {
+			size = client->outsize? client->outsize: GS_OUTBUFSZ;
+			while (size < len + c)
+				size *= 2;
+			if (!(p = realloc(client->outbuf, size))) {
+				EPRINTF("nano-X: client %d can't allocate output queue\n", client->id);
+				GsClose(client->id);
+				return -1;
+			}
+			client->outbuf = p;
+			client->outsize = size;
+		}
+	}
+
+#if HAVE_EPOLL
+	if (len == 0)
+		GsEpollOutput(client->id, GR_TRUE);
+#endif
+	memcpy(client->outbuf + client->outend, buf, c);
+	client->outend += c;
+	return 0;
+}
+
+/*
+ * Send as much queued output as the client's socket will take.
+ * The queue is freed when empty and requests are read again.
+ */
+void
+GsFlushClient(GR_CLIENT *client)
+{
+	int	e;
+
+	while (GsOutputPending(client)) {
+		e = write(client->id, client->outbuf + client->outstart,
+			client->outend - client->outstart);
+		if (e < 0 && (errno == EINTR || errno == EAGAIN))
+			return;
+		if (e <= 0) {
+			GsClose(client->id);
+			return;
+		}
+		client->outstart += e;
+	}
+
+	free(client->outbuf);
+	client->outbuf = NULL;
+	client->outstart = client->outend = client->outsize = 0;
+#if HAVE_EPOLL
+	GsEpollOutput(client->id, GR_FALSE);
+#endif
+}
+
+/*
+ * This is a wrapper to write().  The client socket is non-blocking,
+ * data it won't take now is queued so the server never waits on a client.
  */
 int GsWrite(int fd, void *buf, int c)
 {
+	GR_CLIENT *client;
 	int e, n;
 
+	client = (curclient && curclient->id == fd)? curclient: GsFindClient(fd);
+	if (!client)
+		return -1;
+
 	n = 0;
 
-	while(n < c) {
-		e = write(fd, ((char *) buf + n), (c - n));
-		if(e <= 0) {
-			/*EPRINTF("nano-X: GsWrite failed %d\n", fd);*/
-			GsClose(fd);
-			return -1;
+	/* write directly unless output is already queued*/
+	if (!GsOutputPending(client)) {
+		while(n < c) {
+			e = write(fd, ((char *) buf + n), (c - n));
+			if(e < 0 && errno == EINTR)
+				continue;
+			if(e < 0 && errno == EAGAIN)
+				break;
+			if(e <= 0) {
+				/*EPRINTF("nano-X: GsWrite failed %d\n", fd);*/
+				GsClose(fd);
+				return -1;
+			}
+			n += e;
 		}
-		n += e;
+		if (n == c)
+			return 0;
 	}
 
-	return 0;
+	return GsQueueOutput(client, (char *)buf + n, c - n);
 }
 
 int GsWriteType(int fd, short type)
@@ -2229,44 +2545,80 @@ int GsWriteType(int fd, short type)
 
 /*
  * This function is used to parse and dispatch requests from the clients.
- * Note that the maximum request size is allocated from the stack
- * in this function.
+ * All data available from the client is read into its input buffer with
+ * a single read, then every complete request in the buffer is dispatched.
+ * A partial request is kept for the next call, so the server never blocks
+ * waiting for the rest of a request.
  */
 void
 GsHandleClient(int fd)
 {
+	GR_CLIENT *client = curclient;
 	nxReq *	req;
 	long	len;
-	char	buf[MAXREQUESTSZ];
+	int	n;
 
 	current_fd = fd;
 #if HAVE_SHAREDMEM_SUPPORT
-	current_shm_cmds = curclient->shm_cmds;
-	current_shm_cmds_size = curclient->shm_cmds_size;
+	current_shm_cmds = client->shm_cmds;
+	current_shm_cmds_size = client->shm_cmds_size;
 #endif
-	/* read request header*/
-	if(GsRead(fd, buf, sizeof(nxReq)))
-		return;
-
-#pragma GCC diagnostic ignored "-Wstrict-aliasing"
-	len = GetReqAlignedLen((nxReq *)&buf[0]);
-	if(len > sizeof(nxReq)) {
-		if(len > MAXREQUESTSZ) {
-			EPRINTF("nano-X: GsHandleClient request too large: %ld > %d\n",
-				len, MAXREQUESTSZ);
-			exit(1);
+	if (!client->inbuf) {
+		client->inbuf = malloc(GS_INBUFSZ);
+		if (!client->inbuf) {
+			EPRINTF("nano-X: GsHandleClient can't allocate input buffer\n");
+			GsClose(fd);
+			return;
 		}
-		/* read additional request data*/
-		if(GsRead(fd, &buf[sizeof(nxReq)], len-sizeof(nxReq)))
+	}
+
+	/* move any partial request to start of buffer*/
+	if (client->instart) {
+		client->inend -= client->instart;
+		memmove(client->inbuf, client->inbuf + client->instart, client->inend);
+		client->instart = 0;
+	}
+
+	/* read everything available that fits*/
+	n = read(fd, client->inbuf + client->inend, GS_INBUFSZ - client->inend);
+	if (n <= 0) {
+		if (n < 0 && (errno == EINTR || errno == EAGAIN))
 			return;
+		if (n == 0)
+			EPRINTF("nano-X: client closed socket: %d\n", fd);
+		else EPRINTF("nano-X: GsHandleClient read failed %d: %d\r\n", n, errno);
+		GsClose(fd);
+		return;
 	}
-	req = (nxReq *)&buf[0];
+	client->inend += n;
+
+	/* dispatch all complete requests*/
+	while (client->inend - client->instart >= (int)sizeof(nxReq)) {
+		req = (nxReq *)(client->inbuf + client->instart);
+		len = GetReqAlignedLen(req);
+		if(len < (long)sizeof(nxReq) || len > MAXREQUESTSZ) {
+			EPRINTF("nano-X: GsHandleClient bad request length: %ld\n", len);
+			GsClose(fd);
+			return;
+		}
+		if (client->inend - client->instart < len)
+			break;			/* wait for rest of request*/
+		client->instart += len;
+
+		if(req->reqType < GrTotalNumCalls) {
+			curfunc = (char *)GrFunctions[req->reqType].name;
+			/*DPRINTF("HandleClient %s\n", curfunc);*/
+#if MW_FEATURE_SERVERSTATS
+			GsDispatchRequest(req, len);
+#else
+			GrFunctions[req->reqType].func(req);
+#endif
+		} else {
+			EPRINTF("nano-X: GsHandleClient bad function\n");
+		}
 
-	if(req->reqType < GrTotalNumCalls) {
-		curfunc = (char *)GrFunctions[req->reqType].name;
-		/*DPRINTF("HandleClient %s\n", curfunc);*/
-		GrFunctions[req->reqType].func(req);
-	} else {
-		EPRINTF("nano-X: GsHandleClient bad function\n");
+		/* stop if request closed the connection*/
+		if (curclient != client)
+			return;
 	}
 }
@@ -10,11 +10,17 @@
 #include "uni_std.h"
 #include "serv.h"
 #include "../drivers/fb.h"	/* for set_data_formatex()*/
+#include "../drivers/genmem.h"
 #if HAVE_MMAP
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #endif
+#if HAVE_SHAREDMEM_SUPPORT
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
 
 /*
  * Redraw the screen completely.
@@ -87,10 +93,17 @@ GsUnrealizeWindow(GR_WINDOW *wp, GR_BOOL temp_unmap)
 
 	/* set window invisible flag*/
 	wp->realized = GR_FALSE;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	for (childwp = wp->children; childwp; childwp = childwp->siblings)
 		GsUnrealizeWindow(childwp, temp_unmap);
 
+#if MW_FEATURE_BACKINGSTORE
+	/* contents may change while unmapped*/
+	if (!temp_unmap)
+		GsFreeBacking(wp);
+#endif
+
 	if (!temp_unmap && wp == mousewp) {
 		GsCheckMouseWindow();
 		GsCheckCursor();
@@ -186,8 +199,16 @@ wp->id, wp->mapped, wp->realized, wp->parent->realized);*/
 		return;
 #endif
 
+#if MW_FEATURE_BACKINGSTORE
+	/* save top level windows about to be covered*/
+	if (wp->parent == rootwp && wp->output)
+		GsBackingSaveArea(wp, wp->x - wp->bordersize, wp->y - wp->bordersize,
+			wp->width + wp->bordersize * 2, wp->height + wp->bordersize * 2);
+#endif
+
 	/* set window visible flag*/
 	wp->realized = GR_TRUE;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	if (!temp) {
 		GsCheckMouseWindow();
@@ -283,10 +304,12 @@ GsDestroyWindow(GR_WINDOW *wp)
 		prevwp->siblings = wp->siblings;
 	}
 	wp->siblings = NULL;
+	++clipgeneration;		/* invalidate cached clip regions*/
 
 	/*
 	 * Remove this window from the complete list of windows.
 	 */
+	GsRemoveResource(GR_RES_WINDOW, wp->id);
 	prevwp = listwp;
 	if (prevwp == wp)
 		listwp = wp->next;
@@ -326,9 +349,14 @@ GsDestroyWindow(GR_WINDOW *wp)
 		GsDestroyPixmap(wp->bgpixmap);
 	if (wp->buffer)
 		GsFreeWindowBuffer(wp);
+#if MW_FEATURE_BACKINGSTORE
+	GsFreeBacking(wp);
+#endif
 #if DYNAMICREGIONS
 	if (wp->clipregion)
 		GdDestroyRegion(wp->clipregion);
+	if (wp->visregion)
+		GdDestroyRegion(wp->visregion);
 #endif
 
 	/* Remove any grabbed keys for this window. */
@@ -356,12 +384,24 @@ GsDestroyPixmap(GR_PIXMAP *pp)
 	GR_PIXMAP	*prevpp;
 	PSD			psd = pp->psd;
 
+#if HAVE_SHAREDMEM_SUPPORT
+	/* detach shared pixel memory, removed when client detaches*/
+	if (psd->flags & PSF_ADDRSHMEM) {
+		shmctl(pp->shmid, IPC_RMID, NULL);
+		shmdt(psd->addr);
+		psd->flags &= ~PSF_ADDRSHMEM;
+	}
+#endif
+	if (pp == clippp)
+		clippp = NULL;
+
 	/* deallocate mem gc*/
 	psd->FreeMemGC(psd);
 
 	/*
 	 * Remove this pixmap from the complete list of pixmaps.
 	 */
+	GsRemoveResource(GR_RES_PIXMAP, pp->id);
 	prevpp = listpp;
 	if (prevpp == pp)
 		listpp = pp->next;
@@ -658,6 +698,7 @@ GsInitWindowBuffer(GR_WINDOW *wp, GR_SIZE width, GR_SIZE height)
 		GdSetClipRects(pp->psd, 1, &cliprect);
 #endif
 		clipwp = NULL;			/* reset clip cache for next window draw*/
+		clippp = NULL;
 		curgcp = NULL;			/* invalidate gc cache since we're changing color and mode*/
 		GdSetFillMode(GR_FILL_SOLID);
 		GdSetMode(GR_MODE_COPY);
@@ -691,6 +732,194 @@ GsFreeWindowBuffer(GR_WINDOW *wp)
 	wp->buffer = NULL;
 }
 
+#if MW_FEATURE_BACKINGSTORE
+/*
+ * Backing store for top level windows.  Visible parts of a top level
+ * window about to be covered are first copied from the screen into an
+ * offscreen pixmap, so that when uncovered they can be restored with a
+ * blit instead of an exposure event and client redraw.  The saved area
+ * is kept in backvalid and discarded whenever the window or any of its
+ * children are drawn into.  Backing pixmaps are kept in LRU order and the
+ * least recently used freed when total memory would exceed backingmax.
+ */
+long		backingmax = MW_BACKINGSTORE_MAXKB * 1024L;
+static long	backingmem;		/* backing store memory in use*/
+static GR_WINDOW *backinglru;		/* most recently used backing store window*/
+
+/* move window to front of LRU list*/
+static void
+GsBackingUse(GR_WINDOW *wp)
+{
+	if (wp == backinglru)
+		return;
+	if (wp->backprev)
+		wp->backprev->backnext = wp->backnext;
+	if (wp->backnext)
+		wp->backnext->backprev = wp->backprev;
+	wp->backprev = NULL;
+	wp->backnext = backinglru;
+	if (backinglru)
+		backinglru->backprev = wp;
+	backinglru = wp;
+}
+
+/* free window's backing store pixmap*/
+void
+GsFreeBacking(GR_WINDOW *wp)
+{
+	if (!wp->backing)
+		return;
+	if (wp->backprev)
+		wp->backprev->backnext = wp->backnext;
+	else backinglru = wp->backnext;
+	if (wp->backnext)
+		wp->backnext->backprev = wp->backprev;
+	wp->backnext = wp->backprev = NULL;
+
+	backingmem -= wp->backing->size;
+	wp->backing->FreeMemGC(wp->backing);
+	wp->backing = NULL;
+	GdDestroyRegion(wp->backvalid);
+	wp->backvalid = NULL;
+}
+
+/* free all backing store, used when screen changes*/
+void
+GsFreeAllBacking(void)
+{
+	while (backinglru)
+		GsFreeBacking(backinglru);
+}
+
+/* allocate backing store pixmap, freeing least recently used if needed*/
+static GR_BOOL
+GsAllocBacking(GR_WINDOW *wp)
+{
+	GR_WINDOW *lastwp;
+	unsigned int size, pitch;
+
+	GdCalcMemGCAlloc(wp->psd, wp->width, wp->height, 0, 0, &size, &pitch);
+	if ((long)size > backingmax)
+		return GR_FALSE;
+	while (backingmem + size > backingmax) {
+		for (lastwp = backinglru; lastwp->backnext; lastwp = lastwp->backnext)
+			continue;
+		GsFreeBacking(lastwp);
+	}
+
+	wp->backing = GdCreatePixmap(wp->psd, wp->width, wp->height, 0, NULL, 0);
+	if (!wp->backing)
+		return GR_FALSE;
+	wp->backvalid = GdAllocRegion();
+	backingmem += wp->backing->size;
+	GsBackingUse(wp);
+	return GR_TRUE;
+}
+
+/*
+ * Discard saved contents of the top level window containing wp,
+ * called when anything in it is drawn.
+ */
+void
+GsBackingInvalidate(GR_WINDOW *wp)
+{
+	while (wp->parent && wp->parent != rootwp)
+		wp = wp->parent;
+	if (wp->backing && wp->backvalid->numRects)
+		GdSetRectRegion(wp->backvalid, 0, 0, 0, 0);
+}
+
+/*
+ * Save the visible part of top level window wp within the passed
+ * root window area into its backing store, before it is covered.
+ */
+void
+GsBackingSave(GR_WINDOW *wp, GR_COORD rootx, GR_COORD rooty, GR_SIZE width,
+	GR_SIZE height)
+{
+	MWCLIPREGION *vis, *area;
+
+	if (wp->parent != rootwp || !wp->realized || !wp->output ||
+	    (wp->props & GR_WM_PROPS_BUFFERED) || backingmax <= 0)
+		return;
+
+	/* visible area of window and children to be saved*/
+	vis = GsCalcVisRegion(wp, GR_MODE_EXCLUDECHILDREN);
+	area = GdAllocRectRegion(rootx, rooty, rootx + width, rooty + height);
+	GdIntersectRegion(vis, vis, area);
+	GdDestroyRegion(area);
+	if (!vis->numRects || (!wp->backing && !GsAllocBacking(wp))) {
+		GdDestroyRegion(vis);
+		return;
+	}
+	GsBackingUse(wp);
+
+	/* copy screen to backing store clipped to saved area*/
+	GdOffsetRegion(vis, -wp->x, -wp->y);
+	GdUnionRegion(wp->backvalid, wp->backvalid, vis);
+	GdSetClipRegion(wp->backing, vis);
+	GdBlit(wp->backing, 0, 0, wp->width, wp->height, wp->psd, wp->x, wp->y, MWROP_COPY);
+	clipwp = NULL;			/* reset clip cache for next draw*/
+	clippp = NULL;
+}
+
+/*
+ * Save the visible parts of all top level windows except skipwp within
+ * the passed root window area, before a window is mapped, moved, raised
+ * or resized over it.
+ */
+void
+GsBackingSaveArea(GR_WINDOW *skipwp, GR_COORD rootx, GR_COORD rooty,
+	GR_SIZE width, GR_SIZE height)
+{
+	GR_WINDOW *wp;
+
+	for (wp = rootwp->children; wp; wp = wp->siblings) {
+		if (wp != skipwp && wp->realized &&
+		    rootx < wp->x + wp->width && rooty < wp->y + wp->height &&
+		    rootx + width > wp->x && rooty + height > wp->y)
+			GsBackingSave(wp, rootx, rooty, width, height);
+	}
+}
+
+/*
+ * Restore the passed root window area of top level window wp and its
+ * children from backing store.  Returns GR_FALSE if any visible part of
+ * the area wasn't saved, in which case the caller must expose it.
+ */
+GR_BOOL
+GsBackingRestore(GR_WINDOW *wp, GR_COORD rootx, GR_COORD rooty, GR_SIZE width,
+	GR_SIZE height)
+{
+	MWCLIPREGION *vis, *area;
+
+	if (!wp->backing || !wp->backvalid->numRects)
+		return GR_FALSE;
+
+	vis = GsCalcVisRegion(wp, GR_MODE_EXCLUDECHILDREN);
+	area = GdAllocRectRegion(rootx, rooty, rootx + width, rooty + height);
+	GdIntersectRegion(vis, vis, area);
+
+	/* check all of visible area was saved*/
+	GdCopyRegion(area, wp->backvalid);
+	GdOffsetRegion(area, wp->x, wp->y);
+	GdSubtractRegion(area, vis, area);
+	if (area->numRects) {
+		GdDestroyRegion(area);
+		GdDestroyRegion(vis);
+		return GR_FALSE;
+	}
+	GdDestroyRegion(area);
+	GsBackingUse(wp);
+
+	GdSetClipRegion(wp->psd, vis);
+	GdBlit(wp->psd, wp->x, wp->y, wp->width, wp->height, wp->backing, 0, 0, MWROP_COPY);
+	clipwp = NULL;			/* reset clip cache for next draw*/
+	clippp = NULL;
+	return GR_TRUE;
+}
+#endif /* MW_FEATURE_BACKINGSTORE*/
+
 /*
  * Clear the specified area of a window and possibly make an exposure event.
  * This sets the area window to its background color or pixmap.  If the
@@ -727,6 +956,10 @@ GsClearWindow(GR_WINDOW *wp, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE  hei
 	if (x >= wp->width || y >= wp->height || width <= 0 || height <= 0)
 		return;
 
+#if MW_FEATURE_BACKINGSTORE
+	GsBackingInvalidate(wp);
+#endif
+
 	/*
 	 * Buffered window drawing. First check if drawing finalized and
 	 * set flag.  Physical window background erase is never performed
@@ -841,6 +1074,12 @@ GsExposeArea(GR_WINDOW *wp, GR_COORD rootx, GR_COORD rooty, GR_SIZE width,
 		(rooty + height > wp->y + wp->height))
 			GsDrawBorder(wp);
 
+#if MW_FEATURE_BACKINGSTORE
+	/* restore window and children from backing store if saved*/
+	if (wp->parent == rootwp && GsBackingRestore(wp, rootx, rooty, width, height))
+		return;
+#endif
+
 	/*
 	 * Now clear the window itself in the specified area,
 	 * which might cause an exposure event.
@@ -876,6 +1115,11 @@ GsDrawBorder(GR_WINDOW *wp)
 	if (bs <= 0)
 		return;
 
+#if MW_FEATURE_BACKINGSTORE
+	/* child borders lie within top level window*/
+	GsBackingInvalidate(wp->parent);
+#endif
+
 	width = wp->width;
 	height = wp->height;
 	lminx = wp->x - bs;
@@ -893,7 +1137,7 @@ GsDrawBorder(GR_WINDOW *wp)
 
 	clipwp = NULL;
 	/* FIXME: window clipregion will fail here */
-	GsSetClipWindow(wp, NULL, 0);
+	GsSetClipWindow(wp, NULL, GS_CLIP_NOCACHE);
 	curgcp = NULL;
 	GdSetMode(GR_MODE_COPY);
 	GdSetForegroundColor(wp->psd, wp->bordercolor);
@@ -980,17 +1224,14 @@ GsFindWindow(GR_WINDOW_ID id)
 		return cachewp;
 
 	/*
-	 * No, search for it and cache it for future calls.
+	 * No, look it up and cache it for future calls.
 	 */
-	for (wp = listwp; wp; wp = wp->next) {
-		if (wp->id == id) {
-			cachewindowid = id;
-			cachewp = wp;
-			return wp;
-		}
+	wp = GsLookupResource(GR_RES_WINDOW, id);
+	if (wp) {
+		cachewindowid = id;
+		cachewp = wp;
 	}
-
-	return NULL;
+	return wp;
 }
 
 
@@ -1008,17 +1249,14 @@ GsFindPixmap(GR_WINDOW_ID id)
 		return cachepp;
 
 	/*
-	 * No, search for it and cache it for future calls.
+	 * No, look it up and cache it for future calls.
 	 */
-	for (pp = listpp; pp; pp = pp->next) {
-		if (pp->id == id) {
-			cachepixmapid = id;
-			cachepp = pp;
-			return pp;
-		}
+	pp = GsLookupResource(GR_RES_PIXMAP, id);
+	if (pp) {
+		cachepixmapid = id;
+		cachepp = pp;
 	}
-
-	return NULL;
+	return pp;
 }
 
 
@@ -1039,14 +1277,13 @@ GsFindGC(GR_GC_ID gcid)
 		return cachegcp;
 
 	/*
-	 * No, search for it and cache it for future calls.
+	 * No, look it up and cache it for future calls.
 	 */
-	for (gcp = listgcp; gcp; gcp = gcp->next) {
-		if (gcp->id == gcid) {
-			cachegcid = gcid;
-			cachegcp = gcp;
-			return gcp;
-		}
+	gcp = GsLookupResource(GR_RES_GC, gcid);
+	if (gcp) {
+		cachegcid = gcid;
+		cachegcp = gcp;
+		return gcp;
 	}
 
 	GsError(GR_ERROR_BAD_GC_ID, gcid);
@@ -1058,43 +1295,214 @@ GsFindGC(GR_GC_ID gcid)
 GR_REGION *
 GsFindRegion(GR_REGION_ID regionid)
 {
-	GR_REGION	*regionp;	/* current region pointer */
-
-	for (regionp = listregionp; regionp; regionp = regionp->next) {
-		if (regionp->id == regionid) {
-			return regionp;
-		}
-	}
-
-	return NULL;
+	return GsLookupResource(GR_RES_REGION, regionid);
 }
 
 /* find a font with specified id*/
 GR_FONT *
 GsFindFont(GR_FONT_ID fontid)
 {
-	GR_FONT		*fontp;
-
-	for (fontp = listfontp; fontp; fontp = fontp->next) {
-		if (fontp->id == fontid)
-			return fontp;
-	}
-	return NULL;
+	return GsLookupResource(GR_RES_FONT, fontid);
 }
 
 /* find a cursor with specified id*/
 GR_CURSOR *
 GsFindCursor(GR_CURSOR_ID cursorid)
 {
-	GR_CURSOR	*cursorp;
+	return GsLookupResource(GR_RES_CURSOR, cursorid);
+}
+
+/*
+ * Resource id hash table.
+ *
+ * All windows, pixmaps, gcs, regions, fonts and cursors are entered
+ * by (type, id) into a single open addressed hash table, giving
+ * constant time lookup of the ids passed in client requests.
+ * Deleted slots are marked and reclaimed when the table is rebuilt.
+ * Should the table ever fail to grow, lookups fall back to walking
+ * the resource lists.
+ */
+#define RES_EMPTY		0		/* never used slot*/
+#define RES_DELETED		(-1)	/* removed slot, continue probing*/
+#define RES_MINSIZE		256		/* initial table size, power of 2*/
+
+typedef struct {
+	int		type;		/* GR_RES_xxx, RES_EMPTY or RES_DELETED*/
+	GR_ID	id;
+	void *	ptr;
+} GR_RESENTRY;
+
+static GR_RESENTRY *restab;		/* hash table*/
+static int		ressize;		/* table size, power of 2*/
+static int		resused;		/* used + deleted slots*/
+static int		rescount;		/* used slots*/
+static GR_BOOL	resfailed;		/* table alloc failed, use list walks*/
+
+static unsigned int
+reshash(int type, GR_ID id)
+{
+	return ((id * 2654435761u) >> 8) ^ (type * 0x9e37u);
+}
+
+/* rehash all entries into new table of passed size*/
+static GR_BOOL
+resrehash(int newsize)
+{
+	GR_RESENTRY *oldtab = restab;
+	GR_RESENTRY *tab;
+	int oldsize = ressize;
+	int i;
+
+	tab = calloc(newsize, sizeof(GR_RESENTRY));
+	if (!tab)
+		return GR_FALSE;
+
+	restab = tab;
+	ressize = newsize;
+	resused = rescount;
+	for (i = 0; i < oldsize; i++) {
+		if (oldtab[i].type > 0) {
+			unsigned int h = reshash(oldtab[i].type, oldtab[i].id) & (newsize - 1);
+
+			while (tab[h].type != RES_EMPTY)
+				h = (h + 1) & (newsize - 1);
+			tab[h] = oldtab[i];
+		}
+	}
+	free(oldtab);
+	return GR_TRUE;
+}
+
+/* find an entry's slot, or -1 if not present*/
+static int
+resfind(int type, GR_ID id)
+{
+	unsigned int h;
+
+	if (!restab)
+		return -1;
+	h = reshash(type, id) & (ressize - 1);
+	while (restab[h].type != RES_EMPTY) {
+		if (restab[h].type == type && restab[h].id == id)
+			return h;
+		h = (h + 1) & (ressize - 1);
+	}
+	return -1;
+}
+
+/* enter a newly created resource into the id hash table*/
+void
+GsAddResource(int type, GR_ID id, void *ptr)
+{
+	unsigned int h;
+
+	/* keep load factor including deleted slots under 3/4*/
+	if ((resused + 1) * 4 > ressize * 3) {
+		int newsize = ressize? ressize: RES_MINSIZE;
+
+		while ((rescount + 1) * 2 > newsize)
+			newsize <<= 1;
+		if (!resrehash(newsize)) {
+			EPRINTF("nano-X: resource table alloc failed, using list lookups\n");
+			resfailed = GR_TRUE;
+			return;
+		}
+	}
+
+	h = reshash(type, id) & (ressize - 1);
+	while (restab[h].type > 0)
+		h = (h + 1) & (ressize - 1);
+	if (restab[h].type == RES_EMPTY)
+		resused++;
+	restab[h].type = type;
+	restab[h].id = id;
+	restab[h].ptr = ptr;
+	rescount++;
+}
+
+/* remove a resource being destroyed from the id hash table*/
+void
+GsRemoveResource(int type, GR_ID id)
+{
+	int h = resfind(type, id);
 
-	for (cursorp = listcursorp; cursorp; cursorp = cursorp->next) {
-		if (cursorp->id == cursorid)
-			return cursorp;
+	if (h >= 0) {
+		restab[h].type = RES_DELETED;
+		restab[h].ptr = NULL;
+		rescount--;
+	}
+}
+
+/* slow path lookup by walking resource lists*/
+static void *
+reslistfind(int type, GR_ID id)
+{
+	switch (type) {
+	case GR_RES_WINDOW:
+		{
+			GR_WINDOW *wp;
+			for (wp = listwp; wp; wp = wp->next)
+				if (wp->id == id)
+					return wp;
+		}
+		break;
+	case GR_RES_PIXMAP:
+		{
+			GR_PIXMAP *pp;
+			for (pp = listpp; pp; pp = pp->next)
+				if (pp->id == id)
+					return pp;
+		}
+		break;
+	case GR_RES_GC:
+		{
+			GR_GC *gcp;
+			for (gcp = listgcp; gcp; gcp = gcp->next)
+				if (gcp->id == id)
+					return gcp;
+		}
+		break;
+	case GR_RES_REGION:
+		{
+			GR_REGION *regionp;
+			for (regionp = listregionp; regionp; regionp = regionp->next)
+				if (regionp->id == id)
+					return regionp;
+		}
+		break;
+	case GR_RES_FONT:
+		{
+			GR_FONT *fontp;
+			for (fontp = listfontp; fontp; fontp = fontp->next)
+				if (fontp->id == id)
+					return fontp;
+		}
+		break;
+	case GR_RES_CURSOR:
+		{
+			GR_CURSOR *cursorp;
+			for (cursorp = listcursorp; cursorp; cursorp = cursorp->next)
+				if (cursorp->id == id)
+					return cursorp;
+		}
+		break;
 	}
 	return NULL;
 }
 
+/* return resource pointer of passed type and id, or NULL*/
+void *
+GsLookupResource(int type, GR_ID id)
+{
+	int h;
+
+	if (resfailed)
+		return reslistfind(type, id);
+
+	h = resfind(type, id);
+	return (h >= 0)? restab[h].ptr: NULL;
+}
+
 /*
  * Prepare to do drawing in a window or pixmap using the specified
  * graphics context.  Returns the drawable pointer if successful,
@@ -1135,44 +1543,58 @@ GsPrepareDrawing(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp)
 		if (pp == NULL)
 				return GR_DRAW_TYPE_NONE;
 havepixmap:
+		/*
+		 * If the pixmap is not the currently clipped one or the gc has
+		 * changed, then make it the current one and define its clip region.
+		 * Consecutive draws to the same pixmap and gc keep the clip region.
+		 */
+		if (pp != clippp || gcp->changed) {
 #if DYNAMICREGIONS
-		reg = GdAllocRectRegion(0, 0, pp->psd->xvirtres, pp->psd->yvirtres);
-		/* intersect with user region if any*/
-		if (gcp->regionid) {
-			regionp = GsFindRegion(gcp->regionid);
-			if (regionp) {
-				/* handle pixmap offsets*/
-				if (gcp->xoff || gcp->yoff) {
-					MWCLIPREGION *local = GdAllocRegion();
-
-					GdCopyRegion(local, regionp->rgn);
-					GdOffsetRegion(local, gcp->xoff, gcp->yoff);
-					GdIntersectRegion(reg, reg, local);
-					GdDestroyRegion(local);
-				} else
-					GdIntersectRegion(reg, reg, regionp->rgn);
+			reg = GdAllocRectRegion(0, 0, pp->psd->xvirtres, pp->psd->yvirtres);
+			/* intersect with user region if any*/
+			if (gcp->regionid) {
+				regionp = GsFindRegion(gcp->regionid);
+				if (regionp) {
+					/* handle pixmap offsets*/
+					if (gcp->xoff || gcp->yoff) {
+						MWCLIPREGION local;
+
+						GdInitRegion(&local);
+						GdCopyRegion(&local, regionp->rgn);
+						GdOffsetRegion(&local, gcp->xoff, gcp->yoff);
+						GdIntersectRegion(reg, reg, &local);
+						GdUninitRegion(&local);
+					} else
+						GdIntersectRegion(reg, reg, regionp->rgn);
+				}
 			}
-		}
-		GdSetClipRegion(pp->psd, reg);
+			GdSetClipRegion(pp->psd, reg);
 #else
-		{
-			MWCLIPRECT	cliprect;
-			/* FIXME: setup pixmap clipping, different from windows*/
-	        cliprect.x = 0;
-	        cliprect.y = 0;
-	        cliprect.width = pp->psd->xvirtres;
-	        cliprect.height = pp->psd->yvirtres;
-	        GdSetClipRects(pp->psd, 1, &cliprect);
-		}
+			{
+				MWCLIPRECT	cliprect;
+				/* FIXME: setup pixmap clipping, different from windows*/
+		        cliprect.x = 0;
+		        cliprect.y = 0;
+		        cliprect.width = pp->psd->xvirtres;
+		        cliprect.height = pp->psd->yvirtres;
+		        GdSetClipRects(pp->psd, 1, &cliprect);
+			}
 #endif
-		/* reset clip cache for next window draw*/
-		clipwp = NULL;
+			/* reset clip cache for next window draw*/
+			clipwp = NULL;
+			clippp = pp;
+		}
 	} else {
 		if (!wp->output) {
 				GsError(GR_ERROR_INPUT_ONLY_WINDOW, id);
 				return GR_DRAW_TYPE_NONE;
 		}
 
+#if MW_FEATURE_BACKINGSTORE
+		/* drawing makes saved contents stale*/
+		GsBackingInvalidate(wp);
+#endif
+
 		/* check if buffered window*/
 		if (wp->props & GR_WM_PROPS_BUFFERED) {
 			pp = wp->buffer;
@@ -1194,13 +1616,14 @@ havepixmap:
 
 		 	/* Special handling if user region is not at offset 0,0*/
 			if (regionp && (gcp->xoff || gcp->yoff)) {
-				MWCLIPREGION *local = GdAllocRegion();
+				MWCLIPREGION local;
 
-				GdCopyRegion(local, regionp->rgn);
-				GdOffsetRegion(local, gcp->xoff, gcp->yoff);
+				GdInitRegion(&local);
+				GdCopyRegion(&local, regionp->rgn);
+				GdOffsetRegion(&local, gcp->xoff, gcp->yoff);
 
-				GsSetClipWindow(wp, local, gcp->mode & ~GR_MODE_DRAWMASK);
-				GdDestroyRegion(local);
+				GsSetClipWindow(wp, &local, gcp->mode & ~GR_MODE_DRAWMASK);
+				GdUninitRegion(&local);
 			} else
 				GsSetClipWindow(wp, regionp? regionp->rgn: NULL, gcp->mode & ~GR_MODE_DRAWMASK);
 #else
@@ -1489,6 +1912,11 @@ GsSetPortraitMode(int mode)
 
 	/* reset clip and root window size*/
 	clipwp = NULL;
+	clippp = NULL;
+	++clipgeneration;
+#if MW_FEATURE_BACKINGSTORE
+	GsFreeAllBacking();
+#endif
 	rootwp->width = scrdev.xvirtres;
 	rootwp->height = scrdev.yvirtres;
 
@@ -4,11 +4,21 @@ int
 XDrawSegments(Display * dpy,
 	      Drawable d, GC gc, XSegment * segments, int nsegments)
 {
-	int i;
+	GR_POINT points[128];
+	int i, n;
 
-	for (i = 0; i < nsegments; i++) {
-		GrLine(d, gc->gid, segments[i].x1, segments[i].y1,
-			segments[i].x2, segments[i].y2);
+	/* must copy since X points are shorts, Nano-X are MWCOORDs (int) */
+	while (nsegments > 0) {
+		n = (nsegments > 64)? 64: nsegments;
+		for (i = 0; i < n; i++) {
+			points[i*2].x = segments->x1;
+			points[i*2].y = segments->y1;
+			points[i*2+1].x = segments->x2;
+			points[i*2+1].y = segments->y2;
+			++segments;
+		}
+		GrLines(d, gc->gid, n, points);
+		nsegments -= n;
 	}
 
 	return 1;
@@ -12,12 +12,21 @@ XFillRectangle(Display *xdpy, Drawable d, GC gc, int x, int y,
 
 int 
 XFillRectangles(Display *dpy, Drawable d, GC gc, XRectangle *rects, int nrects) {
-	int i;
+	GR_RECT grects[64];
+	int i, n;
 
-	for(i = 0; i < nrects; i++) {
-		XFillRectangle(dpy, d, gc, rects->x, rects->y,
-				rects->width, rects->height);
-		++rects;
+	/* must copy since X rects are shorts, Nano-X are MWCOORDs (int) */
+	while (nrects > 0) {
+		n = (nrects > 64)? 64: nrects;
+		for(i = 0; i < n; i++) {
+			grects[i].x = rects->x;
+			grects[i].y = rects->y;
+			grects[i].width = rects->width;
+			grects[i].height = rects->height;
+			++rects;
+		}
+		GrFillRects(d, gc->gid, n, grects);
+		nrects -= n;
 	}
 
 	return 1;
@@ -422,57 +422,43 @@ XImage *XGetSubImage(Display *dpy, Drawable d, int x, int y,
 	return dest_image;
 }
 
-/* This takes a portion of the image buffer and rearranges it to keep from 
-   freaking out GrArea. This will take into account a shifted src_x 
-   (or a width that is not as large as the declared image width).
-*/
+/* max bytes of image rows gathered into a temporary buffer per GrArea*/
+#define MAXBANDBYTES	16384
+
+/*
+ * Output part of an image whose rows aren't contiguous in the image buffer
+ * (shifted src_x, narrower width, or padded lines).  Rows are gathered a band
+ * at a time into a small buffer, or when wide, passed to GrArea directly
+ * from the image one row at a time, so no width*height copy is made.
+ */
 static void
-showPartialImage(Display *display, GR_WINDOW_ID d, GR_GC_ID gc, GR_RECT *srect,
-	GR_RECT *drect, char *src, int pixtype, int pad)
+showPartialImage(GR_WINDOW_ID d, GR_GC_ID gc, char *src, int pitch,
+	int dest_x, int dest_y, int width, int height, int pixtype, int size)
 {
+	int rowbytes = width * size;
+	int rows = MAXBANDBYTES / rowbytes;
+	int y, r, n;
 	char *dst, *buffer;
-	char *ptr = src;  /* This will already be adjusted to the inital X and Y of the image */
-	int r, size = 0;
 
-	switch(pixtype) {
-	case MWPF_TRUECOLOR332: 
-	case MWPF_TRUECOLOR233: 
-		size = 1;
-		break;
-	case MWPF_TRUECOLOR555:
-	case MWPF_TRUECOLOR565:
-		size = 2;
-		break;
-	case MWPF_TRUECOLORRGB:
-		size = 3;
-		break;
-	case MWPF_TRUECOLORARGB:
-	case MWPF_TRUECOLORABGR:
-		size = 4;
-		break;
-	case MWPF_HWPIXELVAL:
-		size = display->screens[0].root_depth / 8;
-		break;
+	/* wide rows go straight from the image*/
+	if (rows < 2) {
+		for (y = 0; y < height; y++, src += pitch)
+			GrArea(d, gc, dest_x, dest_y + y, width, 1, src, pixtype);
+		return;
 	}
 
-	/* Allocate a local buffer - this is much faster than doing N GrArea calls */
-	dst = buffer = (char *)ALLOCA( (drect->width * size) * drect->height);
-	if (!dst)
+	if (rows > height)
+		rows = height;
+	buffer = (char *)ALLOCA(rows * rowbytes);
+	if (!buffer)
 		return;
 
-	/* Copy each row to the buffer */
-	for(r = 0; r < drect->height; r++) {
-		memcpy(dst, ptr, drect->width * size); 
-		dst += (drect->width * size);
-
-		/* Move to the end of the line on the real buffer */
-		ptr += (srect->width - srect->x) * size + pad;
-
-		/* And then offset ourselves accordingly          */
-		ptr += (srect->x * size);
+	for (y = 0; y < height; y += n) {
+		n = MWMIN(rows, height - y);
+		for (r = 0, dst = buffer; r < n; r++, dst += rowbytes, src += pitch)
+			memcpy(dst, src, rowbytes);
+		GrArea(d, gc, dest_x, dest_y + y, width, n, buffer, pixtype);
 	}
-	       
-	GrArea(d, gc, drect->x, drect->y, drect->width, drect->height, buffer, pixtype);
 	FREEA(buffer);
 }
 
@@ -542,22 +528,9 @@ DPRINTF("putTrueColorImage depth %d pixtype %d src %d,%d wxh %d,%d dst %d,%d\n",
 	pad = image->bytes_per_line - (image->width * drawsize);
 	if (!pad && (src_x == 0) && (width == image->width))
 		GrArea((GR_WINDOW_ID)d, (GR_GC_ID)gc->gid, dest_x, dest_y, width, height, src, pixtype);
-	else {
-		GR_RECT srect, drect;
-
-		srect.x = src_x;
-		srect.y = src_y;
-		srect.width = image->width;
-		srect.height = image->height;
-
-		drect.x = dest_x;
-		drect.y = dest_y;
-		drect.width = width;
-		drect.height = height;
-
-		showPartialImage(display, (GR_WINDOW_ID)d, (GR_GC_ID)gc->gid,
-			&srect, &drect, src, pixtype, pad);
-	}
+	else if (width > 0 && height > 0)
+		showPartialImage((GR_WINDOW_ID)d, (GR_GC_ID)gc->gid, src, image->bytes_per_line,
+			dest_x, dest_y, width, height, pixtype, drawsize);
 
 	/* turn background drawing back off... */
 	GrSetGCUseBackground(gc->gid, GR_FALSE);
@@ -565,24 +538,79 @@ DPRINTF("putTrueColorImage depth %d pixtype %d src %d,%d wxh %d,%d dst %d,%d\n",
 	return 1;
 }
 
+/* return colormap RGB value for image pixel*/
+static MWPIXELVAL
+colormapvalue(nxColormap *colormap, unsigned long cl)
+{
+	if (cl < (unsigned long)colormap->cur_color)
+		return colormap->colorval[cl].value;
+
+	// FIXME colors kluged as if truecolor here, no colormap entries
+	DPRINTF("XPutImage: unknown color index %lx\n", cl);
+	return 0;
+}
+
+/* convert one image row of colormap indices to RGB*/
+static void
+convertImageRow(XImage *image, nxColormap *colormap, int x, int y,
+	unsigned int width, MWPIXELVAL *dst)
+{
+	unsigned char *src = (unsigned char *)image->data + y * image->bytes_per_line;
+	unsigned int i;
+
+	switch (image->bits_per_pixel) {
+	case 32:
+		src += x << 2;
+		for (i = 0; i < width; i++, src += 4)
+			*dst++ = colormapvalue(colormap, *(uint32_t *)src);
+		break;
+	case 24:
+		src += x * 3;
+		for (i = 0; i < width; i++, src += 3)
+			*dst++ = colormapvalue(colormap, src[0] | (src[1] << 8) | (src[2] << 16));
+		break;
+	case 16:
+		src += x << 1;
+		for (i = 0; i < width; i++, src += 2)
+			*dst++ = colormapvalue(colormap, *(unsigned short *)src);
+		break;
+	case 8:
+		src += x;
+		for (i = 0; i < width; i++)
+			*dst++ = colormapvalue(colormap, *src++);
+		break;
+	case 1:
+		for (i = 0; i < width; i++, x++) {
+			//cl = ((XGCValues *)gc->ext_data)->foreground;
+			*dst++ = READ_BIT(image, x, y)? WHITE: BLACK;
+		}
+		break;
+	default:
+		memset(dst, 0, width * sizeof(MWPIXELVAL));
+		break;
+	}
+}
+
 /*
  * Output a palette-oriented image.  Must have properly defined colormap.
  * These images are defined in any bpp but contain colormap indices.
+ * Rows are converted to RGB a band at a time into a bounded buffer.
  */
 static int
 putImage(Display * display, Drawable d, GC gc, XImage * image,
 	int src_x, int src_y, int dest_x, int dest_y,
 	unsigned int width, unsigned int height)
 {
-	unsigned int x, y;
+	unsigned int y, r, n, rows;
 	MWPIXELVAL *buffer, *dst;
-	nxColormap *colormap;
-	unsigned char *src = (unsigned char *)image->data
-		+ ((src_y * (image->bytes_per_line)) + src_x);
+	nxColormap *colormap = NULL;
 
 	/*DPRINTF("putImage: bpp %d %d,%d -> %d,%d %d,%d\n", image->depth,
 		src_x, src_y, dest_x, dest_y, width, height);*/
 
+	if (width == 0 || height == 0)
+		return 1;
+
 	if (image->bits_per_pixel >= 8) {
 		colormap = _nxFindColormap(XDefaultColormap(display, 0));
 		if (!colormap)
@@ -590,62 +618,21 @@ putImage(Display * display, Drawable d, GC gc, XImage * image,
 		DPRINTF("curcolor %x\n", colormap->cur_color);
 	}
 
-	buffer = ALLOCA(width * height * sizeof(MWPIXELVAL));
-
-	for (y = src_y; y < src_y + height; y++) {
-		dst = buffer + y * width;
-		for (x = src_x; x < src_x + width; x++, dst++) {
-			unsigned short cl;
-
-			/* get colormap index bits from image*/
-			switch (image->bits_per_pixel) {
-			case 32:
-				cl = (unsigned short) *((MWPIXELVAL *) src);
-				src += 4;
-				break;
-			case 24:
-				cl = src[0];        /* B */
-				cl |= src[1] << 8;  /* G */
-				cl |= src[2] << 16; /* R */
-				src += 3;
-				break;
-			case 16:
-				cl = (unsigned short) *((unsigned short *) src);
-				src += 2;
-				break;
-
-			case 8:
-				cl = (unsigned short) *((unsigned char *) src);
-				src += 1;
-				break;
-
-			case 1:
-				if (READ_BIT(image, x, y)) {
-					//cl = colormap->colorval[1].value;
-					//cl = ((XGCValues *)gc->ext_data)->foreground;
-					*dst = WHITE;
-				} else {
-					//cl = colormap->colorval[0].value;
-					*dst = BLACK;
-				}
-				continue;
-
-			default:
-				cl = 0;
-				break;
-			}
-
-			if (cl < colormap->cur_color)
-				*dst = (unsigned long) colormap->colorval[cl].value;
-			else {
-				// FIXME colors kluged as if truecolor here, no colormap entries
-				DPRINTF("XPutImage: unknown color index %x\n", cl);
-				*dst = 0;
-			}
-		}
-	}
+	rows = MAXBANDBYTES / (width * sizeof(MWPIXELVAL));
+	if (rows < 1)
+		rows = 1;
+	if (rows > height)
+		rows = height;
+	buffer = ALLOCA(width * rows * sizeof(MWPIXELVAL));
+	if (!buffer)
+		return 0;
 
-	GrArea((GR_WINDOW_ID) d, (GR_GC_ID) gc->gid, dest_x, dest_y, width, height, buffer, MWPF_RGB);
+	for (y = 0; y < height; y += n) {
+		n = MWMIN(rows, height - y);
+		for (r = 0, dst = buffer; r < n; r++, dst += width)
+			convertImageRow(image, colormap, src_x, src_y + y + r, width, dst);
+		GrArea((GR_WINDOW_ID) d, (GR_GC_ID) gc->gid, dest_x, dest_y + y, width, n, buffer, MWPF_RGB);
+	}
 
 	FREEA(buffer);
 	return 1;
@@ -26,11 +26,53 @@ static FILE * _nxOpenFontDir(char *str);
 static void _nxSetDefaultFontDir(void);
 static void _nxSetFontDir(char **directories, int ndirs);
 static void _nxFreeFontDir(char ***list);
+static void _nxFreeFontIndex(void);
 
 /* nxlib font.c*/
 static char **_nxfontlist = NULL;
 static int _nxfontcount = 0;
 
+/*
+ * In-memory index of each font directory's fonts.dir and fonts.alias,
+ * read once on first use and discarded when the font path changes.
+ * Exact XLFD and alias lookups are hashed, wildcard and scaleable
+ * searches scan the parsed entries without any file access.
+ * Hash chains and scans run in file order, so results are the same
+ * as reading the files line by line.
+ */
+typedef struct {
+	char *	file;			/* font filename, first fonts.dir field*/
+	char *	xlfd;			/* XLFD, second fonts.dir field*/
+	int		dashes;			/* number of '-' in XLFD*/
+	int		height;			/* XLFD pixel height, 0 if scaleable*/
+	int		next;			/* next entry with same hash, -1 at end*/
+} nxFontEntry;
+
+typedef struct {
+	char *	name;			/* aliased fontspec, first fonts.alias field*/
+	char *	alias;			/* replacement, second fonts.alias field*/
+	int		next;			/* next alias with same hash, -1 at end*/
+} nxFontAlias;
+
+typedef struct {
+	int		indexed;		/* directory has been read*/
+	int		hasfontsdir;	/* fonts.dir exists*/
+	int		nfonts;
+	nxFontEntry *fonts;
+	int		nscaleable;
+	int *	scaleable;		/* indices of -0- height fonts, in file order*/
+	int		naliases;
+	nxFontAlias *aliases;
+	unsigned int fontmask;	/* hash buckets - 1*/
+	int *	fonthash;		/* first font by XLFD hash*/
+	unsigned int aliasmask;
+	int *	aliashash;		/* first alias by name hash*/
+	char *	dirtext;		/* fonts.dir contents referenced by fonts*/
+	char *	aliastext;		/* fonts.alias contents referenced by aliases*/
+} nxFontDir;
+
+static nxFontDir *_nxfontdirs = NULL;	/* index for each _nxfontlist entry*/
+
 static FILE *
 _nxOpenFontDir(char *str)
 {
@@ -97,11 +139,221 @@ _nxFreeFontDir(char ***addrlist)
 
 	/* possibly zero globals*/
 	if (addrlist == &_nxfontlist) {
+		_nxFreeFontIndex();
 		_nxfontlist = 0;
 		_nxfontcount = 0;
 	}
 }
 
+/* read whole file into a nul terminated buffer*/
+static char *
+readfontfile(FILE *fp)
+{
+	char *buf = NULL;
+	size_t len = 0, alloc = 0, n;
+
+	do {
+		if (len + 1024 >= alloc) {
+			char *p = realloc(buf, alloc += 4096);
+			if (!p) {
+				free(buf);
+				return NULL;
+			}
+			buf = p;
+		}
+		n = fread(buf + len, 1, alloc - len - 1, fp);
+		len += n;
+	} while (n > 0);
+
+	buf[len] = '\0';
+	return buf;
+}
+
+/* return next line with newline removed, advancing *text, NULL at end*/
+static char *
+nextline(char **text)
+{
+	char *line = *text;
+	char *p;
+
+	if (!*line)
+		return NULL;
+	p = strchr(line, '\n');
+	if (p) {
+		*p++ = '\0';
+		*text = p;
+	} else
+		*text = line + strlen(line);
+	return line;
+}
+
+static unsigned int
+fonthash(const char *str)
+{
+	unsigned int h = 2166136261U;
+
+	while (*str)
+		h = (h ^ (unsigned char)*str++) * 16777619U;
+	return h;
+}
+
+/* allocate hash buckets for n items, all empty*/
+static int *
+allochash(int n, unsigned int *mask)
+{
+	unsigned int size = 16;
+	int *hash;
+
+	while (size < (unsigned int)n)
+		size <<= 1;
+	hash = malloc(size * sizeof(int));
+	if (hash)
+		memset(hash, 0xff, size * sizeof(int));		/* -1*/
+	*mask = size - 1;
+	return hash;
+}
+
+static int dashcount(char *name);
+static int xlfdheight(const char *xlfd);
+
+/* read and index fonts.dir and fonts.alias in directory path*/
+static void
+indexfontdir(nxFontDir *dir, char *path)
+{
+	FILE *fp;
+	char *text, *line, *p;
+	int i, fcount;
+
+	dir->indexed = 1;
+
+	fp = _nxOpenFontDir(path);
+	if (fp) {
+		dir->hasfontsdir = 1;
+		dir->dirtext = text = readfontfile(fp);
+		fclose(fp);
+
+		/* first line is fonts.dir entry count*/
+		if (text && (line = nextline(&text)) != NULL && (fcount = atoi(line)) > 0) {
+			dir->fonts = malloc(fcount * sizeof(nxFontEntry));
+			dir->scaleable = malloc(fcount * sizeof(int));
+			if (!dir->fonts || !dir->scaleable)
+				fcount = 0;
+
+			for (i = 0; i < fcount && (line = nextline(&text)) != NULL; i++) {
+				nxFontEntry *fe = &dir->fonts[dir->nfonts];
+
+				/* XLFD is second field*/
+				p = strchr(line, ' ');
+				if (!p)
+					continue;
+				*p++ = '\0';
+				fe->file = line;
+				fe->xlfd = p;
+				fe->dashes = dashcount(p);
+				fe->height = xlfdheight(p);
+				if (fe->height == 0)
+					dir->scaleable[dir->nscaleable++] = dir->nfonts;
+				dir->nfonts++;
+			}
+
+			/* chain in reverse so each chain runs in file order*/
+			dir->fonthash = allochash(dir->nfonts, &dir->fontmask);
+			if (!dir->fonthash)
+				dir->nfonts = dir->nscaleable = 0;
+			for (i = dir->nfonts - 1; i >= 0; i--) {
+				int *bucket = &dir->fonthash[fonthash(dir->fonts[i].xlfd) & dir->fontmask];
+
+				dir->fonts[i].next = *bucket;
+				*bucket = i;
+			}
+		}
+	}
+
+	fp = openfontalias(path);
+	if (fp) {
+		int alloc = 0;
+
+		dir->aliastext = text = readfontfile(fp);
+		fclose(fp);
+
+		while (text && (line = nextline(&text)) != NULL) {
+			/* ignore blank and ! comments*/
+			if (line[0] == '\0' || line[0] == '!')
+				continue;
+
+			/* fontname is first space separated field*/
+			/* check for tab first as filename may have spaces*/
+			p = strchr(line, '\t');
+			if (!p)
+				p = strchr(line, ' ');
+			if (!p)
+				continue;
+			*p = '\0';
+
+			/* alias is second space separated field*/
+			do ++p; while (*p == ' ' || *p == '\t');
+
+			if (dir->naliases == alloc) {
+				nxFontAlias *a = realloc(dir->aliases, (alloc + 32) * sizeof(nxFontAlias));
+				if (!a)
+					break;
+				dir->aliases = a;
+				alloc += 32;
+			}
+			dir->aliases[dir->naliases].name = line;
+			dir->aliases[dir->naliases].alias = p;
+			dir->naliases++;
+		}
+
+		dir->aliashash = allochash(dir->naliases, &dir->aliasmask);
+		if (!dir->aliashash)
+			dir->naliases = 0;
+		for (i = dir->naliases - 1; i >= 0; i--) {
+			int *bucket = &dir->aliashash[fonthash(dir->aliases[i].name) & dir->aliasmask];
+
+			dir->aliases[i].next = *bucket;
+			*bucket = i;
+		}
+	}
+	DPRINTF("indexfontdir: %s %d fonts %d aliases\n", path, dir->nfonts, dir->naliases);
+}
+
+/* return index of font directory f, reading it on first use*/
+static nxFontDir *
+_nxGetFontDir(int f)
+{
+	static nxFontDir nodir = { 1 };
+
+	if (!_nxfontdirs && !(_nxfontdirs = calloc(_nxfontcount, sizeof(nxFontDir))))
+		return &nodir;
+	if (!_nxfontdirs[f].indexed)
+		indexfontdir(&_nxfontdirs[f], _nxfontlist[f]);
+	return &_nxfontdirs[f];
+}
+
+/* discard font directory index, called when font path changes*/
+static void
+_nxFreeFontIndex(void)
+{
+	int f;
+
+	if (!_nxfontdirs)
+		return;
+	for (f = 0; f < _nxfontcount; f++) {
+		nxFontDir *dir = &_nxfontdirs[f];
+
+		free(dir->fonts);
+		free(dir->scaleable);
+		free(dir->aliases);
+		free(dir->fonthash);
+		free(dir->aliashash);
+		free(dir->dirtext);
+		free(dir->aliastext);
+	}
+	free(_nxfontdirs);
+	_nxfontdirs = NULL;
+}
+
 /* nxlib ListFonts.c*/
 struct _list {
 	char **list;
@@ -278,45 +530,25 @@ findfont_wildcard(char *pattern, int maxnames, struct _list *fontlist)
 {
 	int f, i;
 
+	int patdashes = dashcount(pattern);
+	int prefixlen = strcspn(pattern, "*?");	/* literal chars before first wildcard*/
+
 	DPRINTF("findfont_wildcard: '%s' maxnames %d\n", pattern, maxnames);
-	/* loop through each font dir and read fonts.dir*/
+	/* loop through each font dir index*/
 	for (f = 0; f < _nxfontcount; f++) {
-		FILE *fontdir = _nxOpenFontDir(_nxfontlist[f]);
-		int fcount;
-		char buffer[128];
-
-		DPRINTF("nxopenfontdir %s\n", _nxfontlist[f]);
-		if (!fontdir)
-			continue;
-
-		/* get fonts.dir linecount*/
-		if (!fgets(buffer, sizeof(buffer), fontdir) || !(fcount = atoi(buffer))) {
-			fclose(fontdir);
-			continue;
-		}
-
-		/* read XLFD and add to list if matches wildcard pattern*/
-		for (i = 0; i < fcount; i++) {
-			char *xlfd;
-
-			if (!(fgets(buffer, sizeof(buffer), fontdir)))
-				continue;
-			buffer[strlen(buffer) - 1] = '\0';
+		nxFontDir *dir = _nxGetFontDir(f);
+		nxFontEntry *fe = dir->fonts;
 
-			/* XLFD is second field*/
-			xlfd = strchr(buffer, ' ');
-			if (!xlfd)
+		/* add XLFD to fontlist if matches wildcard pattern*/
+		for (i = 0; i < dir->nfonts; i++, fe++) {
+			if (fe->dashes < patdashes || strncmp(pattern, fe->xlfd, prefixlen) != 0)
 				continue;
-			*xlfd++ = '\0';
-
-			/* if XLFD matches pattern, add to fontlist*/
-			if (match(pattern, xlfd)) {
-				DPRINTF("enumfont add: %s\n", xlfd);
-				if (_addFontToList(fontlist, xlfd) == maxnames)
+			if (patternmatch(pattern, patdashes, fe->xlfd, fe->dashes)) {
+				DPRINTF("enumfont add: %s\n", fe->xlfd);
+				if (_addFontToList(fontlist, fe->xlfd) == maxnames)
 					break;
 			}
 		}
-		fclose(fontdir);
 	}
 
 #if ANDROID // FIXME broken, segfaults in strlen code below
@@ -436,48 +668,21 @@ any(int c, const char *str)
 int
 font_findalias(int index, const char *fontspec, char *alias)
 {
-	FILE *aliasfile;
-	int match = 0;
-	char *p;
-	char buffer[256];
-
-	/* loop through each line in the fonts.alias file for match*/
-	aliasfile = openfontalias(_nxfontlist[index]);
-	if (aliasfile) {
-		for (;;) {
-			if (!fgets(buffer, sizeof(buffer), aliasfile))
-				break;
-			buffer[strlen(buffer) - 1] = '\0';
-
-			/* ignore blank and ! comments*/
-			if (buffer[0] == '\0' || buffer[0] == '!')
-				continue;
-
-			/* fontname is first space separated field*/
-			/* check for tab first as filename may have spaces*/
-			p = strchr(buffer, '\t');
-			if (!p)
-				p = strchr(buffer, ' ');
-			if (!p)
-				continue;
-			*p = '\0';
-
-			/* check exact match*/
-			if (strcmp(fontspec, buffer) == 0) {
+	nxFontDir *dir = _nxGetFontDir(index);
+	int i;
 
-				/* alias is second space separated field*/
-				do ++p; while (*p == ' ' || *p == '\t');
+	if (!dir->naliases)
+		return 0;
 
-				strcpy(alias, p);
-				DPRINTF("font_findalias: replacing %s with %s\n", fontspec, alias);
-				match = 1;
-				break;
-			}
+	/* hash chain is in fonts.alias order, first exact match wins*/
+	for (i = dir->aliashash[fonthash(fontspec) & dir->aliasmask]; i >= 0; i = dir->aliases[i].next) {
+		if (strcmp(fontspec, dir->aliases[i].name) == 0) {
+			snprintf(alias, 256, "%s", dir->aliases[i].alias);
+			DPRINTF("font_findalias: replacing %s with %s\n", fontspec, alias);
+			return 1;
 		}
-		fclose(aliasfile);
 	}
-
-	return match;
+	return 0;
 }
 
 /* return height component of XLFD: ...--height-...*/
@@ -499,6 +704,41 @@ xlfdheight(const char *xlfd)
 	return height;
 }
 
+/*
+ * Check for scaleable font match spec with passed pixel size, that is:
+ *     match XLFD  "...normal--0-0-0-0-0-..."
+ * with passed     "...normal--12-0-0-0-0-..."
+ * for height 12.
+ */
+static int
+scaleablematch(const char *fontspec, const char *xlfd)
+{
+	int j, len;
+	int dashcount = 0;
+
+	len = MWMIN(strlen(xlfd), strlen(fontspec));
+
+	/* match before and after height at '--0-' in XLFD string*/
+	for (j = 0; j < len && dashcount < 8; j++) {
+		if (xlfd[j] == '-')
+			dashcount++;
+		if (xlfd[j] != fontspec[j]) {
+			if (dashcount == 7 && xlfd[j] == '0') {
+				int st = j;
+
+				/* pass over passed height*/
+				while (fontspec[j] >= '0' && fontspec[j] <= '9')
+					j++;
+
+				/* and check that rest of XLFD line matches*/
+				return strcmp(&fontspec[j], &xlfd[st+1]) == 0;
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
 /*
  * Search font directory fonts.dir files and return full font pathname matching
  * fontspec, no wildcards allowed.
@@ -524,7 +764,6 @@ static char *
 findfont_nowildcard(const char *fontspec, int *height)
 {
 	int i, f;
-	char buffer[128];
 	char path[256];
 
 	if (!_nxfontcount)
@@ -539,17 +778,18 @@ findfont_nowildcard(const char *fontspec, int *height)
 	if (fontspec[0] == '/')
 		return strdup(fontspec);
 
-	/* loop through each font dir and read fonts.dir*/
+	/* loop through each font dir index*/
 	for (f = 0; f < _nxfontcount; f++) {
-		FILE *fontdir = _nxOpenFontDir(_nxfontlist[f]);
-		int fcount;
+		nxFontDir *dir = _nxGetFontDir(f);
+		nxFontEntry *fe;
+		int exact;
 
 		/*
 		 * If no fonts.dir file, check fontspec as filename.
 		 * This allows .ttf files to be found in typical font directory
 		 * installations for non-X11/XLFD fonts.
 		 */
-		if (!fontdir) {
+		if (!dir->hasfontsdir) {
 			sprintf(path, "%s/%s", _nxfontlist[f], fontspec);
 			if (access(path, F_OK) == 0) {
 				DPRINTF("findfont_nowild: partial path match %s = %s\n", fontspec, path);
@@ -560,116 +800,51 @@ findfont_nowildcard(const char *fontspec, int *height)
 			continue;
 		}
 
-		/* get fonts.dir linecount*/
-		if (!fgets(buffer, sizeof(buffer), fontdir) || !(fcount = atoi(buffer))) {
-			fclose(fontdir);
-			continue;
-		}
-
 		if (fontspec[0] == '-') {
-			/* Fontspec is XLFD: loop throuch each line in the fonts.dir file for XLFD match*/
-			for (i = 0; i < fcount; i++) {
-				char *xlfd;
-
-				/* font filename is first field*/
-				if (!fgets(buffer, sizeof(buffer), fontdir))
-					continue;
-				buffer[strlen(buffer) - 1] = '\0';
-
-				/* XLFD is second field*/
-				xlfd = strchr(buffer, ' ');
-				if (!xlfd)
-					continue;
-				*xlfd++ = '\0';
-
-				/* if XLFD matches fontspec, return full font pathname*/
-				if (strcmp(fontspec, xlfd) == 0) {
-
-					/* return full font pathname and height*/
-					sprintf(path, "%s/%s", _nxfontlist[f], buffer);
-					*height = xlfdheight(xlfd);
-					DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n",
-						fontspec, xlfd, path, *height);
-					fclose(fontdir);
+			/* Fontspec is XLFD: find first exact XLFD match in fonts.dir*/
+			exact = dir->nfonts? dir->fonthash[fonthash(fontspec) & dir->fontmask]: -1;
+			while (exact >= 0 && strcmp(fontspec, dir->fonts[exact].xlfd) != 0)
+				exact = dir->fonts[exact].next;
+
+			/* a scaleable font listed before the exact match takes precedence*/
+			for (i = 0; i < dir->nscaleable && (exact < 0 || dir->scaleable[i] < exact); i++) {
+				fe = &dir->fonts[dir->scaleable[i]];
+				if (scaleablematch(fontspec, fe->xlfd)) {
+
+					/* match - return full font pathname and height*/
+					sprintf(path, "%s/%s", _nxfontlist[f], fe->file);
+					*height = xlfdheight(fontspec);
+					DPRINTF("findfont_nowild: XLFD -0- match %s %s = '%s' height %d\n", fontspec, fe->xlfd, path, *height);
 					return strdup(path);
-				} else {
-					int j;
-					int dashcount = 0;
-					int len;
-
-					/* no exact match, check for match with -0- height*/
-					if (xlfdheight(xlfd) != 0)
-						continue;		/* not scaleable, try next fonts.dir line*/
-
-					/* otherwise check for scaleable font match spec
-				 	 * with passed pixel size, that is:
-				 	 *     match XLFD  "...normal--0-0-0-0-0-..."
-				 	 * with passed     "...normal--12-0-0-0-0-..."
-				 	 * for height 12.
-				 	 */
-					len = MWMIN(strlen(xlfd), strlen(fontspec));
-
-					/* match before and after height at '--0-' in XLFD string*/
-					for (j = 0; j < len && dashcount < 8; j++) {
-						if (xlfd[j] == '-')
-							dashcount++;
-						if (xlfd[j] != fontspec[j]) {
-							if (dashcount == 7 && xlfd[j] == '0') {
-								int st = j;
-
-								/* pass over passed height*/
-								while (fontspec[j] >= '0' && fontspec[j] <= '9')
-									j++;
-
-								/* and check that rest of XLFD line matches*/
-								if (strcmp(&fontspec[j], &xlfd[st+1]) == 0) {
-
-									/* match - return full font pathname and height*/
-									sprintf(path, "%s/%s", _nxfontlist[f], buffer);
-									*height = xlfdheight(fontspec);
-									DPRINTF("findfont_nowild: XLFD -0- match %s %s = '%s' height %d\n", fontspec, xlfd, path, *height);
-									fclose(fontdir);
-									return strdup(path);
-								}
-							}
-							break;
-						}
-					}
 				}
 			}
+
+			if (exact >= 0) {
+				/* return full font pathname and height*/
+				fe = &dir->fonts[exact];
+				sprintf(path, "%s/%s", _nxfontlist[f], fe->file);
+				*height = fe->height;
+				DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n",
+					fontspec, fe->xlfd, path, *height);
+				return strdup(path);
+			}
 		} else {	/* fontspec[0] != '-'*/
 			/*
-		 	 * Fontspec is not XLFD.  Loop through each fonts.dir line and look
+		 	 * Fontspec is not XLFD.  Loop through each fonts.dir entry and look
 		 	 * for fontspec being a prefix of the font filename.
 		 	 */
-			for (i = 0; i < fcount; i++) {
-				char *p;
-
-				/* font filename is first field*/
-				if (!fgets(buffer, sizeof(buffer), fontdir))
-					continue;
-				buffer[strlen(buffer) - 1] = '\0';
-				p = strchr(buffer, ' ');
-				if (!p)
-					continue;
-				*p = '\0';
-
+			for (i = 0, fe = dir->fonts; i < dir->nfonts; i++, fe++) {
 				/* prefix allows font.pcf to match font.pcf.gz for example*/
-				if (prefix(fontspec, buffer)) {
-					char path[256];
+				if (prefix(fontspec, fe->file)) {
 
 					/* return full font pathname*/
-					sprintf(path, "%s/%s", _nxfontlist[f], buffer);
+					sprintf(path, "%s/%s", _nxfontlist[f], fe->file);
 					DPRINTF("findfont_nowild: non-XLFD prefix match %s %s = '%s'\n",
-						fontspec, buffer, path);
-					fclose(fontdir);
+						fontspec, fe->file, path);
 					return strdup(path);
 				}
 			}
 		}
-
-		if (fontdir)
-			fclose(fontdir);
 	}
 
 #if HAVE_STATICFONTS
@@ -686,47 +861,12 @@ findfont_nowildcard(const char *fontspec, int *height)
 					DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n",
 						xlfd, fontspec, staticFontList[i].file, *height);
 					return strdup(staticFontList[i].file);
-				} else {
-					int j;
-					int dashcount = 0;
-					int len;
-
-					/* no exact match, check for match with -0- height*/
-					if (xlfdheight(xlfd) != 0)
-						continue;		/* not scaleable, try next fonts.dir line*/
-
-					/* otherwise check for scaleable font match spec
-				 	 * with passed pixel size, that is:
-				 	 *     match XLFD  "...normal--0-0-0-0-0-..."
-				 	 * with passed     "...normal--12-0-0-0-0-..."
-				 	 * for height 12.
-				 	 */
-					len = MWMIN(strlen(xlfd), strlen(fontspec));
-
-					/* match before and after height at '--0-' in XLFD string*/
-					for (j = 0; j < len && dashcount < 8; j++) {
-						if (xlfd[j] == '-')
-							dashcount++;
-						if (xlfd[j] != fontspec[j]) {
-							if (dashcount == 7 && xlfd[j] == '0') {
-								int st = j;
-
-								/* pass over passed height*/
-								while (fontspec[j] >= '0' && fontspec[j] <= '9')
-									j++;
-
-								/* and check that rest of XLFD line matches*/
-								if (strcmp(&fontspec[j], &xlfd[st+1]) == 0) {
-
-									/* match - return full font pathname and height*/
-									*height = xlfdheight(fontspec);
-									DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n", xlfd, fontspec, staticFontList[i].file, *height);
-									return strdup(staticFontList[i].file);
-								}
-							}
-							break;
-						}
-					}
+				} else if (xlfdheight(xlfd) == 0 && scaleablematch(fontspec, xlfd)) {
+
+					/* match - return full font pathname and height*/
+					*height = xlfdheight(fontspec);
+					DPRINTF("findfont_nowild: exact XLFD match %s %s = %s (%d)\n", xlfd, fontspec, staticFontList[i].file, *height);
+					return strdup(staticFontList[i].file);
 				}
 			}
 		}